@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <fmt/format.h>
+
+#include <kanban_markdown/kanban_board.hpp>
+#include <kanban_markdown/internal.hpp>
+
+using namespace kanban_markdown;
+
+// A board with list_count lists of tasks_per_list tasks, using labels, descriptions, attachments and checklists.
+static KanbanBoard create_board(unsigned int list_count, unsigned int tasks_per_list) {
+	KanbanBoard kanban_board;
+	kanban_board.name = "Benchmark Board";
+	kanban_board.description = "Synthetic board used to measure the readers and writers.";
+	kanban_board.color = "#5186b8";
+	kanban_board.created = internal::now_utc();
+	kanban_board.last_modified = kanban_board.created;
+	kanban_board.version = 42;
+
+	for (unsigned int i = 0; i < 16; i++) {
+		std::shared_ptr<KanbanLabel> kanban_label = std::make_shared<KanbanLabel>();
+		kanban_label->name = fmt::format("Label <{}> & 'Co'", i);
+		kanban_label->color = "#d12929";
+		kanban_board.labels.push_back(kanban_label);
+	}
+
+	for (unsigned int i = 0; i < list_count; i++) {
+		std::shared_ptr<KanbanList> kanban_list = std::make_shared<KanbanList>();
+		kanban_list->name = fmt::format("List {}", i);
+		kanban_list->counter = 1;
+		kanban_list->checked = i % 2 == 0;
+		for (unsigned int j = 0; j < tasks_per_list; j++) {
+			std::shared_ptr<KanbanTask> kanban_task = std::make_shared<KanbanTask>();
+			kanban_task->name = fmt::format("Task Number {} of List {}", j, i);
+			kanban_task->counter = 1;
+			kanban_task->checked = j % 3 == 0;
+			if (j % 2 == 0) {
+				kanban_task->description.push_back("A description line that is reasonably long.");
+				kanban_task->description.push_back("And a second one.");
+			}
+			if (j % 5 == 0) {
+				std::shared_ptr<KanbanLabel>& kanban_label = kanban_board.labels[j % kanban_board.labels.size()];
+				kanban_task->labels.push_back(kanban_label);
+				kanban_label->tasks.push_back(kanban_task);
+			}
+			if (j % 7 == 0) {
+				kanban_task->attachments.push_back(std::make_shared<KanbanAttachment>(KanbanAttachment{ "Image", "https://example.com/image.png" }));
+			}
+			if (j % 4 == 0) {
+				kanban_task->checklist.push_back(std::make_shared<KanbanChecklistItem>(KanbanChecklistItem{ true, "First step" }));
+				kanban_task->checklist.push_back(std::make_shared<KanbanChecklistItem>(KanbanChecklistItem{ false, "Second step" }));
+			}
+			kanban_list->tasks.push_back(kanban_task);
+		}
+		kanban_board.list.push_back(kanban_list);
+	}
+	return kanban_board;
+}
+
+// Average seconds taken by one call of function.
+template <typename Function>
+static double measure_seconds(int iterations, Function function) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		function();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / iterations;
+}
@@ -0,0 +1,41 @@
+#include <iostream>
+#include <string>
+
+#include <fmt/format.h>
+#include <yyjson.h>
+
+#include <kanban_markdown/kanban_markdown.hpp>
+
+#include "board.hpp"
+
+// Compares how long a board takes to load from each format.
+// There is no reader building a board from JSON, so the JSON column only measures yyjson parsing the document.
+int main(int argc, char** argv) {
+	const int iterations = argc > 1 ? std::stoi(argv[1]) : 5;
+	const KanbanBoard kanban_board = create_board(100, 1000);
+
+	const std::string markdown = writer::markdown::format_str(kanban_board);
+	const std::string json = writer::json::format_str(kanban_board);
+	const std::string binary = writer::binary::format_str(kanban_board);
+
+	auto maybe_binary_board = reader::binary::parse(binary);
+	if (!maybe_binary_board.has_value() || writer::markdown::format_str(maybe_binary_board.value()) != markdown) {
+		std::cout << "Error: The binary board does not match the original board\n";
+		return 1;
+	}
+
+	const double markdown_seconds = measure_seconds(iterations, [&]() { return reader::parse(markdown); });
+	const double json_seconds = measure_seconds(iterations, [&]() {
+		yyjson_doc* doc = yyjson_read(json.c_str(), json.size(), 0);
+		yyjson_doc_free(doc);
+	});
+	const double binary_seconds = measure_seconds(iterations, [&]() { return reader::binary::parse(binary); });
+
+	const double binary_save_seconds = measure_seconds(iterations, [&]() { return writer::binary::format_str(kanban_board); });
+
+	std::cout << "Board: 100000 tasks\n";
+	std::cout << fmt::format("markdown  {:8.1f} MiB  load {:10.2f} ms\n", markdown.size() / (1024.0 * 1024.0), markdown_seconds * 1000);
+	std::cout << fmt::format("json      {:8.1f} MiB  load {:10.2f} ms  (parse only)\n", json.size() / (1024.0 * 1024.0), json_seconds * 1000);
+	std::cout << fmt::format("binary    {:8.1f} MiB  load {:10.2f} ms  save {:8.2f} ms\n", binary.size() / (1024.0 * 1024.0), binary_seconds * 1000, binary_save_seconds * 1000);
+	return 0;
+}
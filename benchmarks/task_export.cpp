@@ -0,0 +1,34 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <kanban_markdown/kanban_markdown.hpp>
+
+#include "board.hpp"
+
+// Measures exporting the tasks of a board as NDJSON and CSV.
+// The records are written to a counting sink, the exporter only ever holding its stream buffer.
+int main(int argc, char** argv) {
+	const int iterations = argc > 1 ? std::stoi(argv[1]) : 3;
+	const KanbanBoard kanban_board = create_board(1000, 1000);
+
+	for (writer::tasks::Format format : { writer::tasks::Format::ndjson, writer::tasks::Format::csv }) {
+		writer::tasks::Flags kanban_writer_flags;
+		kanban_writer_flags.format = format;
+		std::size_t bytes = 0;
+		const double seconds = measure_seconds(iterations, [&]() {
+			bytes = 0;
+			writer::json::Stream stream([&bytes](const char* data, std::size_t size) { bytes += size; });
+			writer::tasks::format(kanban_board, stream, kanban_writer_flags);
+		});
+		std::cout << fmt::format("{:8}  1000000 tasks  {:8.1f} MiB  {:10.2f} ms  {:8.1f} MiB/s\n",
+			format == writer::tasks::Format::ndjson ? "ndjson" : "csv",
+			bytes / (1024.0 * 1024.0),
+			seconds * 1000,
+			bytes / (1024.0 * 1024.0) / seconds
+		);
+	}
+	return 0;
+}
@@ -162,6 +162,11 @@ class KanbanMarkdownEditorProvider {
                 format: 'markdown',
             });
         }).then(data => {
+            // Small boards are sent without compression
+            if (data.encoding === 'none') {
+                this.updateTextDocument(document, data.markdown);
+                return;
+            }
             this.decompressGzipString(data.markdown, (/** @type {any} */ err, /** @type {string} */ markdown) => {
                 if (err) {
                     console.error('Error decompressing string:', err);
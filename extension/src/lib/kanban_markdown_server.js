@@ -24,6 +24,7 @@ class KanbanMarkdownServer {
     constructor(context) {
         this.context = context;
         this.requestMap = new Map();
+        this.notificationListeners = [];
     }
 
     static async new(context) {
@@ -71,6 +72,13 @@ class KanbanMarkdownServer {
                 try {
                     const response = JSON.parse(line);
 
+                    // Sent without a request, such as when a watched board's file changes
+                    if (response.notification !== undefined) {
+                        for (const listener of this.notificationListeners) {
+                            listener(response);
+                        }
+                        continue;
+                    }
                     if (this.requestMap.has(response.id)) {
                         // console.log('Received response:', JSON.stringify(response));
                         this.requestMap.get(response.id)(response);
@@ -108,6 +116,13 @@ class KanbanMarkdownServer {
         });
     }
 
+    /**
+     * @param {(notification: any) => void} listener 
+     */
+    onNotification(listener) {
+        this.notificationListeners.push(listener);
+    }
+
     /**
      * 
      */
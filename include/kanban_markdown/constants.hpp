@@ -19,4 +19,12 @@ namespace kanban_markdown::constants {
 
 	const std::string time_format = "%Y-%m-%d %H:%M:%S UTC";
 
+	// Value of the [Checksum Version] property, files without it use the SHA-256 of the body
+	const unsigned int checksum_version_sha256 = 1;
+	const unsigned int checksum_version_merkle = 2;
+
+	// Start of a board written by writer::binary, followed by the version of its layout
+	const std::string binary_magic = "KBMD";
+	const unsigned int binary_format_version = 1;
+
 }
\ No newline at end of file
@@ -1,47 +1,240 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include <asap/asap.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KANBAN_MARKDOWN_SSE2
+#endif
+
 namespace kanban_markdown::internal {
-	static inline std::string string_to_id(const std::string& string)
+	// Writes the anchor id of a name to an output iterator, so callers can format ids without a temporary string.
+	template <typename OutputIt>
+	static inline OutputIt format_string_to_id(std::string_view string, OutputIt out)
 	{
-		std::string buffer;
-		buffer.reserve(string.size() * 1.1);
 		for (char character : string) {
 			switch (character) {
 			case ' ':
-				buffer += '_';
+				*out++ = '_';
 				break;
 			case '<':
-				buffer += "&lt;";
+				out = std::copy_n("&lt;", 4, out);
 				break;
 			case '>':
-				buffer += "&gt;";
+				out = std::copy_n("&gt;", 4, out);
 				break;
 			case '&':
-				buffer += "&amp;";
+				out = std::copy_n("&amp;", 5, out);
 				break;
 			case '"':
-				buffer += "&quot;";
+				out = std::copy_n("&quot;", 6, out);
 				break;
 			case '\'':
-				buffer += "&apos;";
+				out = std::copy_n("&apos;", 6, out);
 				break;
 			default:
-				if ((character >= 'A' && character <= 'Z') || (character >= 'a' && character <= 'z')) {
-					buffer += std::tolower(character);
+				if (character >= 'A' && character <= 'Z') {
+					*out++ = static_cast<char>(character - 'A' + 'a');
 				}
 				else {
-					buffer += character;
+					*out++ = character;
 				}
 				break;
 			}
 		}
+		return out;
+	}
+
+	// Same output as format_string_to_id. With SSE2, 16 characters are handled at once:
+	// a block without any character to escape is lowercased and has its spaces replaced in a few instructions,
+	// only a block holding one goes through format_string_to_id.
+	static inline void append_string_to_id(std::string_view string, std::string& out)
+	{
+		std::size_t i = 0;
+#ifdef KANBAN_MARKDOWN_SSE2
+		const __m128i less_than = _mm_set1_epi8('<');
+		const __m128i greater_than = _mm_set1_epi8('>');
+		const __m128i ampersand = _mm_set1_epi8('&');
+		const __m128i double_quote = _mm_set1_epi8('"');
+		const __m128i single_quote = _mm_set1_epi8('\'');
+		const __m128i before_a = _mm_set1_epi8('A' - 1);
+		const __m128i after_z = _mm_set1_epi8('Z' + 1);
+		const __m128i case_bit = _mm_set1_epi8(0x20);
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i underscore = _mm_set1_epi8('_');
+		for (; i + 16 <= string.size(); i += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(string.data() + i));
+			const __m128i escapes = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(block, less_than), _mm_cmpeq_epi8(block, greater_than)),
+				_mm_or_si128(_mm_cmpeq_epi8(block, ampersand), _mm_or_si128(_mm_cmpeq_epi8(block, double_quote), _mm_cmpeq_epi8(block, single_quote)))
+			);
+			if (_mm_movemask_epi8(escapes) != 0) {
+				format_string_to_id(string.substr(i, 16), std::back_inserter(out));
+				continue;
+			}
+			// The comparisons are signed, so bytes of multibyte UTF-8 characters are never taken for capitals
+			const __m128i capitals = _mm_and_si128(_mm_cmpgt_epi8(block, before_a), _mm_cmplt_epi8(block, after_z));
+			block = _mm_add_epi8(block, _mm_and_si128(capitals, case_bit));
+			const __m128i spaces = _mm_cmpeq_epi8(block, space);
+			block = _mm_or_si128(_mm_andnot_si128(spaces, block), _mm_and_si128(spaces, underscore));
+
+			const std::size_t size = out.size();
+			out.resize(size + 16);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out.data() + size), block);
+		}
+#endif
+		format_string_to_id(string.substr(i), std::back_inserter(out));
+	}
+
+	static inline std::string string_to_id(const std::string& string)
+	{
+		std::string buffer;
+		buffer.reserve(string.size() * 1.1);
+		append_string_to_id(string, buffer);
 		return buffer;
 	}
 
+	// Number of threads to use for a requested count, 0 meaning one per core.
+	static inline std::size_t thread_count(unsigned int threads)
+	{
+		if (threads == 0) {
+			threads = std::thread::hardware_concurrency();
+		}
+		return std::max<std::size_t>(threads, 1);
+	}
+
+	// Threads shared by every parallel_for in the program, one per core besides the calling thread.
+	// They are started on first use and joined when the program exits.
+	class WorkerPool {
+	public:
+		static WorkerPool& shared() {
+			static WorkerPool pool(thread_count(0) - 1);
+			return pool;
+		}
+
+		std::size_t size() const {
+			return this->workers.size();
+		}
+
+		void post(std::function<void()> task) {
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->tasks.push_back(std::move(task));
+			}
+			this->available.notify_one();
+		}
+
+		~WorkerPool() {
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->stopping = true;
+			}
+			this->available.notify_all();
+			for (auto& worker : this->workers) {
+				worker.join();
+			}
+		}
+
+	private:
+		explicit WorkerPool(std::size_t threads) {
+			this->workers.reserve(threads);
+			for (std::size_t i = 0; i < threads; i++) {
+				this->workers.emplace_back([this] { this->work(); });
+			}
+		}
+
+		void work() {
+			while (true) {
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(this->mutex);
+					this->available.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+					if (this->tasks.empty()) {
+						return;
+					}
+					task = std::move(this->tasks.front());
+					this->tasks.pop_front();
+				}
+				task();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable available;
+		std::deque<std::function<void()>> tasks;
+		std::vector<std::thread> workers;
+		bool stopping = false;
+	};
+
+	// Runs function(chunk) for every chunk in [0, chunks) on the calling thread and the shared WorkerPool.
+	// The calling thread takes chunks too and only waits for chunks that have started, so a busy pool
+	// (or a parallel_for nested inside another) degrades to running the chunks in place.
+	// Exceptions thrown by a chunk are rethrown once every chunk has finished.
+	template <typename Function>
+	static inline void parallel_for(std::size_t chunks, Function function)
+	{
+		struct State {
+			std::atomic<std::size_t> next{ 0 };
+			std::size_t finished = 0;
+			std::mutex mutex;
+			std::condition_variable done;
+			std::vector<std::exception_ptr> exceptions;
+			Function* function;
+		};
+		// Helpers that start after the last chunk only touch the state, so it outlives this call
+		auto state = std::make_shared<State>();
+		state->exceptions.resize(chunks);
+		state->function = &function;
+		auto run = [chunks](State& state) {
+			std::size_t chunk;
+			while ((chunk = state.next.fetch_add(1)) < chunks) {
+				try {
+					(*state.function)(chunk);
+				}
+				catch (...) {
+					state.exceptions[chunk] = std::current_exception();
+				}
+				std::lock_guard<std::mutex> lock(state.mutex);
+				if (++state.finished == chunks) {
+					state.done.notify_one();
+				}
+			}
+		};
+
+		if (chunks > 1) {
+			WorkerPool& pool = WorkerPool::shared();
+			const std::size_t helpers = std::min(chunks - 1, pool.size());
+			for (std::size_t i = 0; i < helpers; i++) {
+				pool.post([state, run] { run(*state); });
+			}
+		}
+		run(*state);
+		{
+			std::unique_lock<std::mutex> lock(state->mutex);
+			state->done.wait(lock, [&] { return state->finished == chunks; });
+		}
+		for (auto& exception : state->exceptions) {
+			if (exception) {
+				std::rethrow_exception(exception);
+			}
+		}
+	}
+
 	static constexpr inline uint32_t hash(const std::string_view s) noexcept
 	{
 		uint32_t hash = 5381;
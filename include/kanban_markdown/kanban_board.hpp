@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <vector>
 #include <memory>
@@ -10,6 +11,7 @@
 #include <tsl/robin_map.h>
 #include <tsl/robin_set.h>
 
+#include <kanban_markdown/constants.hpp>
 #include <kanban_markdown/internal.hpp>
 
 namespace kanban_markdown {
@@ -35,6 +37,47 @@ namespace kanban_markdown {
 		tsl::robin_set<unsigned int> used_hash;
 	};
 
+	// Output a writer rendered for a node, reused until something edits the node and calls invalidate().
+	struct KanbanRenderCache {
+		void invalidate() {
+			this->markdown_valid = false;
+			this->markdown_digest_valid = false;
+			this->html_valid = false;
+		}
+
+		bool markdown_valid = false;
+		bool markdown_github = false;
+		std::string markdown;
+
+		bool markdown_digest_valid = false;
+		std::array<unsigned char, 32> markdown_digest;
+
+		bool html_valid = false;
+		std::string html;
+	};
+
+	// Anchor id of a node's name, see internal::string_to_id.
+	// Computed when a writer first asks for it and kept until whatever renames the node calls invalidate().
+	class KanbanSlugCache {
+	public:
+		const std::string& get(const std::string& name) const {
+			if (!this->valid) {
+				this->slug.clear();
+				internal::append_string_to_id(name, this->slug);
+				this->valid = true;
+			}
+			return this->slug;
+		}
+
+		void invalidate() {
+			this->valid = false;
+		}
+
+	private:
+		mutable bool valid = false;
+		mutable std::string slug;
+	};
+
 	struct KanbanAttachment
 	{
 		bool operator==(const KanbanAttachment& other) const {
@@ -87,6 +130,9 @@ namespace kanban_markdown {
 		std::string color;
 		std::string name;
 		std::vector<std::shared_ptr<KanbanTask>> tasks;
+
+		KanbanRenderCache render_cache;
+		KanbanSlugCache slug_cache;
 	};
 
 	struct KanbanTask
@@ -129,6 +175,9 @@ namespace kanban_markdown {
 		std::vector<std::shared_ptr<KanbanLabel>> labels;
 		std::vector<std::shared_ptr<KanbanAttachment>> attachments;
 		std::vector<std::shared_ptr<KanbanChecklistItem>> checklist;
+
+		KanbanRenderCache render_cache;
+		KanbanSlugCache slug_cache;
 	};
 
 	struct KanbanList
@@ -153,6 +202,8 @@ namespace kanban_markdown {
 		unsigned int counter;
 		std::string name;
 		std::vector<std::shared_ptr<KanbanTask>> tasks;
+
+		KanbanRenderCache render_cache;
 	};
 
 	struct KanbanBoard
@@ -182,7 +233,10 @@ namespace kanban_markdown {
 		asap::datetime created;
 		asap::datetime last_modified;
 		unsigned int version;
+		unsigned int checksum_version = constants::checksum_version_sha256;
 		std::string checksum;
+		// Whether the Checksum Version 1 checksum read from the file matched its content
+		bool checksum_verified = false;
 
 		std::string name;
 		std::string description;
@@ -198,4 +252,4 @@ CPP_DUMP_DEFINE_EXPORT_OBJECT(kanban_markdown::KanbanChecklistItem, checked, nam
 CPP_DUMP_DEFINE_EXPORT_OBJECT(kanban_markdown::KanbanTask, checked, name, description, labels, attachments, checklist);
 CPP_DUMP_DEFINE_EXPORT_OBJECT(kanban_markdown::KanbanLabel, name, tasks);
 CPP_DUMP_DEFINE_EXPORT_OBJECT(kanban_markdown::KanbanList, checked, name, tasks);
-CPP_DUMP_DEFINE_EXPORT_OBJECT(kanban_markdown::KanbanBoard, color, created, last_modified, version, checksum, name, description, labels, list);
+CPP_DUMP_DEFINE_EXPORT_OBJECT(kanban_markdown::KanbanBoard, color, created, last_modified, version, checksum_version, checksum, name, description, labels, list);
@@ -17,10 +17,12 @@
 #include <kanban_markdown/constants.hpp>
 
 #include <kanban_markdown/internal.hpp>
+#include <kanban_markdown/trace.hpp>
 #include <kanban_markdown/utils.hpp>
 
 #include <kanban_markdown/reader/internal.hpp>
 #include <kanban_markdown/reader/builder.hpp>
+#include <kanban_markdown/reader/binary.hpp>
 
 #include <kanban_markdown/reader/section/none.hpp>
 #include <kanban_markdown/reader/section/task.hpp>
@@ -232,7 +234,9 @@ namespace kanban_markdown::reader {
 
 	}
 
-	static inline tl::expected<KanbanBoard, std::string> parse(std::string md_string) {
+	// A board without front matter gets new_checksum_version, Checksum Version 1 unless the caller opts into version 2.
+	static inline tl::expected<KanbanBoard, std::string> parse(std::string md_string, unsigned int new_checksum_version = constants::checksum_version_sha256) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("reader", "parse");
 		internal::KanbanReader kanban_reader;
 
 		bool has_properties = md_string.substr(0, 5) == "---\r\n";
@@ -248,6 +252,9 @@ namespace kanban_markdown::reader {
 				return tl::make_unexpected(properties_read_result.error());
 			};
 
+			// The checksum covers everything after the closing "---\r\n"
+			section::properties::verify(kanban_reader, std::string_view(md_string).substr(end_of_properties + 5));
+
 			md_string = md_string.substr(end_of_properties + 3);
 		}
 		else {
@@ -256,6 +263,7 @@ namespace kanban_markdown::reader {
 			kanban_reader.created = now;
 			kanban_reader.last_modified = now;
 			kanban_reader.version = 0;
+			kanban_reader.checksum_version = new_checksum_version;
 		}
 		kanban_reader.read_properties = true;
 
@@ -270,12 +278,15 @@ namespace kanban_markdown::reader {
 		parser.syntax = nullptr;
 		parser.debug_log = internal::debug;
 
-		int result = md_parse(md_string.c_str(), md_string.size(), &parser, &kanban_reader);
+		int result;
+		{
+			KANBAN_MARKDOWN_TRACE_SCOPE("reader", "md4c");
+			result = md_parse(md_string.c_str(), md_string.size(), &parser, &kanban_reader);
+		}
 		if (result != 0) {
 			std::cerr << "Error parsing Markdown text." << std::endl;
 		}
 
-		KanbanBoard kanban_board = builder::create(kanban_reader);
-		return kanban_board;
+		return builder::create(kanban_reader);
 	}
 }
\ No newline at end of file
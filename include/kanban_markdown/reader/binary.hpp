@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tl/expected.hpp>
+
+#include <kanban_markdown/kanban_board.hpp>
+#include <kanban_markdown/constants.hpp>
+#include <kanban_markdown/trace.hpp>
+
+// Reads boards written by writer::binary, see writer/binary.hpp for the layout.
+namespace kanban_markdown::reader::binary {
+	namespace internal {
+		class Cursor {
+		public:
+			explicit Cursor(std::string_view data) : data(data) {}
+
+			std::uint32_t read_u32() {
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(this->take(4));
+				return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8) | (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+			}
+
+			bool read_bool() {
+				return *this->take(1) != 0;
+			}
+
+			std::string read_string() {
+				const std::uint32_t size = this->read_u32();
+				return std::string(this->take(size), size);
+			}
+
+			asap::datetime read_datetime() {
+				asap::datetime datetime;
+				std::tm& when = datetime.when;
+				for (int* field : { &when.tm_year, &when.tm_mon, &when.tm_mday, &when.tm_hour, &when.tm_min, &when.tm_sec, &when.tm_wday, &when.tm_yday, &when.tm_isdst }) {
+					*field = static_cast<int>(this->read_u32());
+				}
+				return datetime;
+			}
+
+			// Every element takes at least one byte, so a count larger than what is left can only come from a corrupted file.
+			std::uint32_t read_count() {
+				const std::uint32_t count = this->read_u32();
+				if (count > this->data.size() - this->position) {
+					throw std::out_of_range("Invalid binary board. A count is larger than the data.");
+				}
+				return count;
+			}
+
+			std::uint32_t read_index(std::size_t size) {
+				const std::uint32_t index = this->read_u32();
+				if (index >= size) {
+					throw std::out_of_range("Invalid binary board. An index is out of range.");
+				}
+				return index;
+			}
+
+			bool at_end() const {
+				return this->position == this->data.size();
+			}
+
+		private:
+			const char* take(std::size_t size) {
+				if (size > this->data.size() - this->position) {
+					throw std::out_of_range("Invalid binary board. Unexpected end of data.");
+				}
+				const char* bytes = this->data.data() + this->position;
+				this->position += size;
+				return bytes;
+			}
+
+			std::string_view data;
+			std::size_t position = 0;
+		};
+
+		static inline void read_tracker_map(Cursor& cursor, tsl::robin_map<std::string, DuplicateNameTracker>& name_tracker_map) {
+			const std::uint32_t count = cursor.read_count();
+			name_tracker_map.reserve(count);
+			for (std::uint32_t i = 0; i < count; i++) {
+				std::string name = cursor.read_string();
+				DuplicateNameTracker& name_tracker = name_tracker_map[std::move(name)];
+				name_tracker.counter = cursor.read_u32();
+				const std::uint32_t used_hash_count = cursor.read_count();
+				name_tracker.used_hash.reserve(used_hash_count);
+				for (std::uint32_t j = 0; j < used_hash_count; j++) {
+					name_tracker.used_hash.insert(cursor.read_u32());
+				}
+			}
+		}
+
+		static inline KanbanBoard read(Cursor& cursor) {
+			KanbanBoard kanban_board;
+			kanban_board.color = cursor.read_string();
+			kanban_board.created = cursor.read_datetime();
+			kanban_board.last_modified = cursor.read_datetime();
+			kanban_board.version = cursor.read_u32();
+			kanban_board.checksum_version = cursor.read_u32();
+			kanban_board.checksum = cursor.read_string();
+			kanban_board.name = cursor.read_string();
+			kanban_board.description = cursor.read_string();
+
+			const std::uint32_t label_count = cursor.read_count();
+			kanban_board.labels.reserve(label_count);
+			for (std::uint32_t i = 0; i < label_count; i++) {
+				std::shared_ptr<KanbanLabel> kanban_label = std::make_shared<KanbanLabel>();
+				kanban_label->name = cursor.read_string();
+				kanban_label->color = cursor.read_string();
+				kanban_board.labels.push_back(std::move(kanban_label));
+			}
+
+			const std::uint32_t list_count = cursor.read_count();
+			kanban_board.list.reserve(list_count);
+			std::vector<std::uint32_t> task_counts;
+			task_counts.reserve(list_count);
+			std::size_t task_count = 0;
+			for (std::uint32_t i = 0; i < list_count; i++) {
+				std::shared_ptr<KanbanList> kanban_list = std::make_shared<KanbanList>();
+				kanban_list->checked = cursor.read_bool();
+				kanban_list->counter = cursor.read_u32();
+				kanban_list->name = cursor.read_string();
+				task_counts.push_back(cursor.read_count());
+				task_count += task_counts.back();
+				kanban_board.list.push_back(std::move(kanban_list));
+			}
+
+			std::vector<std::shared_ptr<KanbanTask>> tasks;
+			tasks.reserve(task_count);
+			for (std::uint32_t i = 0; i < list_count; i++) {
+				KanbanList& kanban_list = *kanban_board.list[i];
+				kanban_list.tasks.reserve(task_counts[i]);
+				for (std::uint32_t j = 0; j < task_counts[i]; j++) {
+					std::shared_ptr<KanbanTask> kanban_task = std::make_shared<KanbanTask>();
+					kanban_task->checked = cursor.read_bool();
+					kanban_task->counter = cursor.read_u32();
+					kanban_task->name = cursor.read_string();
+
+					const std::uint32_t description_count = cursor.read_count();
+					kanban_task->description.reserve(description_count);
+					for (std::uint32_t k = 0; k < description_count; k++) {
+						kanban_task->description.push_back(cursor.read_string());
+					}
+
+					const std::uint32_t task_label_count = cursor.read_count();
+					kanban_task->labels.reserve(task_label_count);
+					for (std::uint32_t k = 0; k < task_label_count; k++) {
+						kanban_task->labels.push_back(kanban_board.labels[cursor.read_index(kanban_board.labels.size())]);
+					}
+
+					const std::uint32_t attachment_count = cursor.read_count();
+					kanban_task->attachments.reserve(attachment_count);
+					for (std::uint32_t k = 0; k < attachment_count; k++) {
+						std::shared_ptr<KanbanAttachment> attachment = std::make_shared<KanbanAttachment>();
+						attachment->name = cursor.read_string();
+						attachment->url = cursor.read_string();
+						kanban_task->attachments.push_back(std::move(attachment));
+					}
+
+					const std::uint32_t checklist_count = cursor.read_count();
+					kanban_task->checklist.reserve(checklist_count);
+					for (std::uint32_t k = 0; k < checklist_count; k++) {
+						std::shared_ptr<KanbanChecklistItem> item = std::make_shared<KanbanChecklistItem>();
+						item->checked = cursor.read_bool();
+						item->name = cursor.read_string();
+						kanban_task->checklist.push_back(std::move(item));
+					}
+
+					tasks.push_back(kanban_task);
+					kanban_list.tasks.push_back(std::move(kanban_task));
+				}
+			}
+
+			for (const auto& kanban_label : kanban_board.labels) {
+				const std::uint32_t label_task_count = cursor.read_count();
+				kanban_label->tasks.reserve(label_task_count);
+				for (std::uint32_t i = 0; i < label_task_count; i++) {
+					kanban_label->tasks.push_back(tasks[cursor.read_index(tasks.size())]);
+				}
+			}
+
+			read_tracker_map(cursor, kanban_board.task_name_tracker_map);
+			read_tracker_map(cursor, kanban_board.list_name_tracker_map);
+			return kanban_board;
+		}
+	}
+
+	static inline tl::expected<KanbanBoard, std::string> parse(std::string_view data) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("reader", "binary");
+		if (data.substr(0, constants::binary_magic.size()) != constants::binary_magic) {
+			return tl::make_unexpected("Invalid binary board. The header is missing.");
+		}
+		internal::Cursor cursor(data.substr(constants::binary_magic.size()));
+		try {
+			const std::uint32_t format_version = cursor.read_u32();
+			if (format_version != constants::binary_format_version) {
+				return tl::make_unexpected("Invalid binary board. The format version is not supported.");
+			}
+			KanbanBoard kanban_board = internal::read(cursor);
+			if (!cursor.at_end()) {
+				return tl::make_unexpected("Invalid binary board. There is data after the board.");
+			}
+			return kanban_board;
+		}
+		catch (const std::out_of_range& e) {
+			return tl::make_unexpected(e.what());
+		}
+	}
+}
@@ -2,17 +2,21 @@
 
 #include <kanban_markdown/kanban_board.hpp>
 #include <kanban_markdown/reader/internal.hpp>
+#include <kanban_markdown/trace.hpp>
 
 namespace kanban_markdown::reader::builder {
 	using namespace kanban_markdown::reader::internal;
 
 	inline KanbanBoard create(KanbanReader& kanban_reader) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("reader", "build");
 		KanbanBoard kanban_board;
 		kanban_board.color = kanban_reader.color;
 		kanban_board.created = kanban_reader.created;
 		kanban_board.last_modified = kanban_reader.last_modified;
 		kanban_board.version = kanban_reader.version;
+		kanban_board.checksum_version = kanban_reader.checksum_version;
 		kanban_board.checksum = kanban_reader.checksum;
+		kanban_board.checksum_verified = kanban_reader.checksum_verified;
 
 		kanban_board.name = kanban_reader.kanban_board_name;
 		kanban_board.description = kanban_reader.kanban_board_description;
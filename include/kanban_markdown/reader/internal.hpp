@@ -7,6 +7,7 @@
 #include <tsl/robin_map.h>
 #include <tsl/ordered_map.h>
 
+#include <kanban_markdown/constants.hpp>
 #include <kanban_markdown/kanban_board.hpp>
 
 namespace kanban_markdown::reader::internal {
@@ -91,7 +92,9 @@ namespace kanban_markdown::reader::internal {
 		asap::datetime created;
 		asap::datetime last_modified;
 		unsigned int version = 0;
+		unsigned int checksum_version = constants::checksum_version_sha256;
 		std::string checksum;
+		bool checksum_verified = false;
 
 		std::string kanban_board_name;
 		bool read_kanban_board_name = false;
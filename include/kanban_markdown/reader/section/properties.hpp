@@ -1,6 +1,9 @@
 #pragma once
 
+#include <string_view>
+
 #include <asap/asap.h>
+#include <picosha2.h>
 #include <tl/expected.hpp>
 #include <yaml-cpp/yaml.h>
 
@@ -28,11 +31,23 @@ namespace kanban_markdown::reader::section::properties {
 			return tl::make_unexpected("Invalid Markdown file. [Last Modified] property is empty.");
 		}
 
-		const std::string checksum = config["Checksum"].as<std::string>();
+		std::string checksum = config["Checksum"].as<std::string>();
+		// The last line of the properties keeps the carriage return of the closing line
+		if (!checksum.empty() && checksum.back() == '\r') {
+			checksum.pop_back();
+		}
 		if (checksum.empty()) {
 			return tl::make_unexpected("Invalid Markdown file. [Checksum] property is empty.");
 		}
 
+		unsigned int checksum_version = constants::checksum_version_sha256;
+		if (config["Checksum Version"]) {
+			checksum_version = config["Checksum Version"].as<unsigned int>();
+			if (checksum_version != constants::checksum_version_sha256 && checksum_version != constants::checksum_version_merkle) {
+				return tl::make_unexpected("Invalid Markdown file. [Checksum Version] property is not supported.");
+			}
+		}
+
 		asap::datetime created_datetime(created, constants::time_format);
 		if (created_datetime.timestamp() == 0) {
 			return tl::make_unexpected("Invalid Markdown file. [Created] property has invalid seconds.");
@@ -49,8 +64,21 @@ namespace kanban_markdown::reader::section::properties {
 
 		kanban_parser.version = version;
 
+		kanban_parser.checksum_version = checksum_version;
 		kanban_parser.checksum = checksum;
 
 		return nullptr;
 	}
+
+	// Checks a Checksum Version 1 checksum against the body as it is in the file.
+	// Checksum Version 2 is the root of a tree built from the rendered board, so checking it costs a full render
+	// and is left to the callers that need it (see writer::markdown::verify).
+	static inline void verify(KanbanReader& kanban_parser, std::string_view body) {
+		if (kanban_parser.checksum_version != constants::checksum_version_sha256) {
+			return;
+		}
+		std::string checksum;
+		picosha2::hash256_hex_string(body.begin(), body.end(), checksum);
+		kanban_parser.checksum_verified = checksum == kanban_parser.checksum;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,180 @@
+#pragma once
+
+// Scoped trace events, written as Chrome trace-event JSON to open in Perfetto or chrome://tracing.
+// Only compiled in when KANBAN_MARKDOWN_TRACE is defined, otherwise the macros below expand to nothing.
+// Compiled in, nothing is recorded until trace::start is called, so a traced build runs as usual until asked to trace.
+//
+//   KANBAN_MARKDOWN_TRACE_SCOPE("reader", "md4c");
+//   KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL("command", "update", path_str);
+
+#ifdef KANBAN_MARKDOWN_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace kanban_markdown::trace {
+	struct Event {
+		const char* category;
+		const char* name;
+		std::string detail;
+		std::uint64_t begin;
+		std::uint64_t duration;
+		std::uint32_t thread;
+	};
+
+	// The events of one thread, only locked by it and by stop
+	struct Buffer {
+		std::mutex mutex;
+		std::vector<Event> events;
+		std::uint32_t thread;
+	};
+
+	class Tracer {
+	public:
+		static Tracer& instance() {
+			static Tracer tracer;
+			return tracer;
+		}
+
+		bool enabled() const {
+			return this->on.load(std::memory_order_relaxed);
+		}
+
+		void start(std::string path) {
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->path = std::move(path);
+			this->origin = std::chrono::steady_clock::now();
+			this->on.store(true, std::memory_order_relaxed);
+		}
+
+		// Writes every event recorded since start to the file given to it.
+		void stop() {
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (!this->on.exchange(false)) {
+				return;
+			}
+			std::FILE* file = std::fopen(this->path.c_str(), "wb");
+			if (file == nullptr) {
+				return;
+			}
+			std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+			bool first = true;
+			for (const auto& buffer : this->buffers) {
+				std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+				for (const Event& event : buffer->events) {
+					fmt::print(file, R"({}{{"cat":"{}","name":"{}","ph":"X","pid":1,"tid":{},"ts":{},"dur":{})", first ? "" : ",\n", event.category, event.name, event.thread, event.begin, event.duration);
+					if (!event.detail.empty()) {
+						fmt::print(file, R"(,"args":{{"detail":"{}"}})", escape(event.detail));
+					}
+					std::fputc('}', file);
+					first = false;
+				}
+				buffer->events.clear();
+			}
+			std::fputs("]}\n", file);
+			std::fclose(file);
+		}
+
+		std::uint64_t now() const {
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->origin).count());
+		}
+
+		void record(Event event) {
+			thread_local std::shared_ptr<Buffer> buffer = this->add_buffer();
+			event.thread = buffer->thread;
+			std::lock_guard<std::mutex> lock(buffer->mutex);
+			buffer->events.push_back(std::move(event));
+		}
+
+	private:
+		std::shared_ptr<Buffer> add_buffer() {
+			std::lock_guard<std::mutex> lock(this->mutex);
+			auto buffer = std::make_shared<Buffer>();
+			buffer->thread = static_cast<std::uint32_t>(this->buffers.size() + 1);
+			this->buffers.push_back(buffer);
+			return buffer;
+		}
+
+		static std::string escape(std::string_view text) {
+			std::string escaped;
+			for (char c : text) {
+				if (c == '"' || c == '\\') {
+					escaped += '\\';
+					escaped += c;
+				}
+				else if (static_cast<unsigned char>(c) < 0x20) {
+					escaped += fmt::format("\\u{:04x}", c);
+				}
+				else {
+					escaped += c;
+				}
+			}
+			return escaped;
+		}
+
+		std::atomic<bool> on = false;
+		std::mutex mutex;
+		std::string path;
+		std::chrono::steady_clock::time_point origin;
+		std::vector<std::shared_ptr<Buffer>> buffers;
+	};
+
+	static inline void start(std::string path) {
+		Tracer::instance().start(std::move(path));
+	}
+
+	static inline void stop() {
+		Tracer::instance().stop();
+	}
+
+	// Records the time from its construction to its destruction, category and name being string literals.
+	class Scope {
+	public:
+		Scope(const char* category, const char* name) : Scope(category, name, std::string()) {}
+
+		Scope(const char* category, const char* name, std::string detail) : active(Tracer::instance().enabled()) {
+			if (this->active) {
+				this->event.category = category;
+				this->event.name = name;
+				this->event.detail = std::move(detail);
+				this->event.begin = Tracer::instance().now();
+			}
+		}
+
+		~Scope() {
+			if (this->active) {
+				this->event.duration = Tracer::instance().now() - this->event.begin;
+				Tracer::instance().record(std::move(this->event));
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		bool active;
+		Event event;
+	};
+}
+
+#define KANBAN_MARKDOWN_TRACE_CONCAT_INNER(a, b) a##b
+#define KANBAN_MARKDOWN_TRACE_CONCAT(a, b) KANBAN_MARKDOWN_TRACE_CONCAT_INNER(a, b)
+#define KANBAN_MARKDOWN_TRACE_SCOPE(category, name) ::kanban_markdown::trace::Scope KANBAN_MARKDOWN_TRACE_CONCAT(kanban_markdown_trace_scope_, __LINE__)(category, name)
+#define KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL(category, name, detail) ::kanban_markdown::trace::Scope KANBAN_MARKDOWN_TRACE_CONCAT(kanban_markdown_trace_scope_, __LINE__)(category, name, detail)
+
+#else
+
+#define KANBAN_MARKDOWN_TRACE_SCOPE(category, name) ((void)0)
+#define KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL(category, name, detail) ((void)0)
+
+#endif
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include <tsl/robin_map.h>
 #include <tsl/robin_set.h>
 
@@ -19,4 +22,45 @@ namespace kanban_markdown::utils {
 		}
 		return counter;
 	}
-}
\ No newline at end of file
+
+	// A task's rendered output includes the names of its labels, and a label's includes the names of its tasks,
+	// so an edit to either has to invalidate both sides.
+	static inline void invalidate_task(KanbanTask& kanban_task) {
+		kanban_task.render_cache.invalidate();
+		for (auto& kanban_label : kanban_task.labels) {
+			kanban_label->render_cache.invalidate();
+		}
+	}
+
+	static inline void invalidate_label(KanbanLabel& kanban_label) {
+		kanban_label.render_cache.invalidate();
+		for (auto& kanban_task : kanban_label.tasks) {
+			kanban_task->render_cache.invalidate();
+		}
+	}
+
+	// Splits the lists of a board in at most chunks contiguous ranges holding about as many tasks each.
+	// Returns the boundaries, range i being [boundaries[i], boundaries[i + 1]).
+	static inline std::vector<std::size_t> split_lists(const KanbanBoard& kanban_board, std::size_t chunks) {
+		std::size_t total_tasks = 0;
+		for (const auto& kanban_list : kanban_board.list) {
+			total_tasks += kanban_list->tasks.size() + 1;
+		}
+		chunks = std::max<std::size_t>(std::min(chunks, kanban_board.list.size()), 1);
+
+		std::vector<std::size_t> boundaries;
+		boundaries.reserve(chunks + 1);
+		boundaries.push_back(0);
+		std::size_t tasks = 0;
+		for (std::size_t i = 0; i < kanban_board.list.size(); i++) {
+			tasks += kanban_board.list[i]->tasks.size() + 1;
+			if (boundaries.size() < chunks && tasks * chunks >= total_tasks * boundaries.size()) {
+				boundaries.push_back(i + 1);
+			}
+		}
+		if (boundaries.back() != kanban_board.list.size()) {
+			boundaries.push_back(kanban_board.list.size());
+		}
+		return boundaries;
+	}
+}
@@ -1,4 +1,7 @@
 #pragma once
 
+#include <kanban_markdown/writer/binary.hpp>
+#include <kanban_markdown/writer/html.hpp>
 #include <kanban_markdown/writer/json.hpp>
 #include <kanban_markdown/writer/markdown.hpp>
+#include <kanban_markdown/writer/tasks.hpp>
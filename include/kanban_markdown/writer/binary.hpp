@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tsl/robin_map.h>
+
+#include <kanban_markdown/kanban_board.hpp>
+#include <kanban_markdown/constants.hpp>
+#include <kanban_markdown/trace.hpp>
+
+// Layout of a binary board, all integers being little endian and strings a u32 length followed by their bytes:
+//   header      magic "KBMD", u32 format version
+//   board       color, created, last modified, u32 version, u32 checksum version, checksum, name, description
+//   labels      u32 count, then name and color of each
+//   lists       u32 count, then u8 checked, u32 counter, name and u32 task count of each
+//   tasks       the tasks of every list one after the other: u8 checked, u32 counter, name, description lines,
+//               label indices, attachments (name, url) and checklist items (u8 checked, name), each behind a u32 count
+//   label tasks for each label, u32 count then the indices of its tasks in the task array
+//   trackers    task names then list names: u32 count, then name, u32 counter and the used hashes behind a u32 count
+// A date is the nine fields of its std::tm as i32.
+namespace kanban_markdown::writer::binary {
+	namespace internal {
+		static inline void write_u32(std::string& out, std::uint32_t value) {
+			const char bytes[] = {
+				static_cast<char>(value & 0xFF),
+				static_cast<char>((value >> 8) & 0xFF),
+				static_cast<char>((value >> 16) & 0xFF),
+				static_cast<char>((value >> 24) & 0xFF),
+			};
+			out.append(bytes, sizeof(bytes));
+		}
+
+		static inline void write_bool(std::string& out, bool value) {
+			out.push_back(value ? 1 : 0);
+		}
+
+		static inline void write_string(std::string& out, const std::string& value) {
+			write_u32(out, static_cast<std::uint32_t>(value.size()));
+			out.append(value);
+		}
+
+		static inline void write_datetime(std::string& out, const asap::datetime& datetime) {
+			const std::tm& when = datetime.when;
+			for (int field : { when.tm_year, when.tm_mon, when.tm_mday, when.tm_hour, when.tm_min, when.tm_sec, when.tm_wday, when.tm_yday, when.tm_isdst }) {
+				write_u32(out, static_cast<std::uint32_t>(field));
+			}
+		}
+
+		static inline void write_tracker_map(std::string& out, const tsl::robin_map<std::string, DuplicateNameTracker>& name_tracker_map) {
+			write_u32(out, static_cast<std::uint32_t>(name_tracker_map.size()));
+			for (const auto& [name, name_tracker] : name_tracker_map) {
+				write_string(out, name);
+				write_u32(out, name_tracker.counter);
+				write_u32(out, static_cast<std::uint32_t>(name_tracker.used_hash.size()));
+				for (const auto& hash : name_tracker.used_hash) {
+					write_u32(out, hash);
+				}
+			}
+		}
+	}
+
+	static inline std::string format_str(const KanbanBoard& kanban_board) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "binary");
+		using namespace internal;
+
+		std::string out;
+		out.append(constants::binary_magic);
+		write_u32(out, constants::binary_format_version);
+
+		write_string(out, kanban_board.color);
+		write_datetime(out, kanban_board.created);
+		write_datetime(out, kanban_board.last_modified);
+		write_u32(out, kanban_board.version);
+		write_u32(out, kanban_board.checksum_version);
+		write_string(out, kanban_board.checksum);
+		write_string(out, kanban_board.name);
+		write_string(out, kanban_board.description);
+
+		tsl::robin_map<const KanbanLabel*, std::uint32_t> label_indices;
+		label_indices.reserve(kanban_board.labels.size());
+		write_u32(out, static_cast<std::uint32_t>(kanban_board.labels.size()));
+		for (const auto& kanban_label : kanban_board.labels) {
+			label_indices.emplace(kanban_label.get(), static_cast<std::uint32_t>(label_indices.size()));
+			write_string(out, kanban_label->name);
+			write_string(out, kanban_label->color);
+		}
+
+		std::size_t task_count = 0;
+		write_u32(out, static_cast<std::uint32_t>(kanban_board.list.size()));
+		for (const auto& kanban_list : kanban_board.list) {
+			write_bool(out, kanban_list->checked);
+			write_u32(out, kanban_list->counter);
+			write_string(out, kanban_list->name);
+			write_u32(out, static_cast<std::uint32_t>(kanban_list->tasks.size()));
+			task_count += kanban_list->tasks.size();
+		}
+
+		tsl::robin_map<const KanbanTask*, std::uint32_t> task_indices;
+		task_indices.reserve(task_count);
+		std::vector<std::uint32_t> indices;
+		for (const auto& kanban_list : kanban_board.list) {
+			for (const auto& kanban_task : kanban_list->tasks) {
+				task_indices.emplace(kanban_task.get(), static_cast<std::uint32_t>(task_indices.size()));
+				write_bool(out, kanban_task->checked);
+				write_u32(out, kanban_task->counter);
+				write_string(out, kanban_task->name);
+
+				write_u32(out, static_cast<std::uint32_t>(kanban_task->description.size()));
+				for (const auto& description_line : kanban_task->description) {
+					write_string(out, description_line);
+				}
+
+				// Labels that are not on the board cannot be referenced
+				indices.clear();
+				for (const auto& kanban_label : kanban_task->labels) {
+					auto it = label_indices.find(kanban_label.get());
+					if (it != label_indices.end()) {
+						indices.push_back(it->second);
+					}
+				}
+				write_u32(out, static_cast<std::uint32_t>(indices.size()));
+				for (std::uint32_t index : indices) {
+					write_u32(out, index);
+				}
+
+				write_u32(out, static_cast<std::uint32_t>(kanban_task->attachments.size()));
+				for (const auto& attachment : kanban_task->attachments) {
+					write_string(out, attachment->name);
+					write_string(out, attachment->url);
+				}
+
+				write_u32(out, static_cast<std::uint32_t>(kanban_task->checklist.size()));
+				for (const auto& item : kanban_task->checklist) {
+					write_bool(out, item->checked);
+					write_string(out, item->name);
+				}
+			}
+		}
+
+		// Tasks that are not in a list cannot be referenced
+		for (const auto& kanban_label : kanban_board.labels) {
+			indices.clear();
+			for (const auto& kanban_task : kanban_label->tasks) {
+				auto it = task_indices.find(kanban_task.get());
+				if (it != task_indices.end()) {
+					indices.push_back(it->second);
+				}
+			}
+			write_u32(out, static_cast<std::uint32_t>(indices.size()));
+			for (std::uint32_t index : indices) {
+				write_u32(out, index);
+			}
+		}
+
+		write_tracker_map(out, kanban_board.task_name_tracker_map);
+		write_tracker_map(out, kanban_board.list_name_tracker_map);
+		return out;
+	}
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+#include <md4c-html.h>
+
+#include <kanban_markdown/kanban_board.hpp>
+#include <kanban_markdown/constants.hpp>
+#include <kanban_markdown/trace.hpp>
+
+// Renders the board as static HTML: a header, the labels, then a section per list holding an item per task.
+// Anchor ids are the same as in the markdown, so links between labels and tasks keep working.
+// The fragment of every label, list header and task is kept in its render cache until the node is edited.
+namespace kanban_markdown::writer::html {
+	using Buffer = fmt::memory_buffer;
+
+	static inline void append(Buffer& buffer, std::string_view string) {
+		buffer.append(string.data(), string.data() + string.size());
+	}
+
+	static inline void append_escaped(Buffer& buffer, std::string_view text) {
+		const char* run = text.data();
+		const char* last = text.data() + text.size();
+		for (const char* it = run; it != last; ++it) {
+			std::string_view entity;
+			switch (*it) {
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			case '&': entity = "&amp;"; break;
+			case '"': entity = "&quot;"; break;
+			case '\'': entity = "&#39;"; break;
+			default: continue;
+			}
+			buffer.append(run, it);
+			append(buffer, entity);
+			run = it + 1;
+		}
+		buffer.append(run, last);
+	}
+
+	// Links may only go to http, https and mailto URLs or be relative, other schemes such as javascript: or data:
+	// being able to run script in the webview the output is shown in.
+	static inline bool is_safe_url(std::string_view url) {
+		std::size_t begin = 0;
+		while (begin < url.size() && static_cast<unsigned char>(url[begin]) <= ' ') {
+			begin++;
+		}
+		std::string scheme;
+		for (std::size_t i = begin; i < url.size(); i++) {
+			const char c = url[i];
+			switch (c) {
+			// Dropped by browsers wherever they are in a URL
+			case '\t':
+			case '\n':
+			case '\r':
+				continue;
+			case '/':
+			case '?':
+			case '#':
+				return true;
+			case ':':
+				return scheme == "http" || scheme == "https" || scheme == "mailto";
+			default:
+				scheme += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			}
+		}
+		return true;
+	}
+
+	// Appends the HTML md4c rendered, with the links to unsafe URLs turned into their text and the images into their alt text.
+	// Raw HTML being escaped, every link and image tag in it was written by md4c, with its attributes escaped.
+	static inline void append_safe_links(Buffer& buffer, std::string_view html) {
+		constexpr std::string_view link_tag = R"(<a href=")";
+		constexpr std::string_view image_tag = R"(<img src=")";
+		constexpr std::string_view link_end = "</a>";
+		constexpr std::string_view alt_attribute = R"( alt=")";
+		std::size_t position = 0;
+		// Set while in a link whose tags are left out
+		bool unwrapping = false;
+		while (true) {
+			const std::size_t link = html.find(link_tag, position);
+			const std::size_t image = html.find(image_tag, position);
+			const std::size_t end = unwrapping ? html.find(link_end, position) : std::string_view::npos;
+			const std::size_t next = std::min({ link, image, end });
+			if (next == std::string_view::npos) {
+				break;
+			}
+			append(buffer, html.substr(position, next - position));
+			if (next == end) {
+				unwrapping = false;
+				position = end + link_end.size();
+				continue;
+			}
+			const bool is_link = next == link;
+			const std::size_t url_begin = next + (is_link ? link_tag : image_tag).size();
+			const std::size_t url_end = html.find('"', url_begin);
+			const std::size_t tag_end = url_end == std::string_view::npos ? std::string_view::npos : html.find('>', url_end);
+			if (tag_end == std::string_view::npos) {
+				break;
+			}
+			const std::string_view tag = html.substr(next, tag_end + 1 - next);
+			if (is_safe_url(html.substr(url_begin, url_end - url_begin))) {
+				append(buffer, tag);
+			}
+			else if (is_link) {
+				unwrapping = true;
+			}
+			else {
+				const std::size_t alt = tag.find(alt_attribute);
+				if (alt != std::string_view::npos) {
+					const std::size_t alt_begin = alt + alt_attribute.size();
+					append(buffer, tag.substr(alt_begin, tag.find('"', alt_begin) - alt_begin));
+				}
+			}
+			position = tag_end + 1;
+		}
+		append(buffer, html.substr(position));
+	}
+
+	// Raw HTML in descriptions is escaped rather than passed through, the output being shown in a webview.
+	static inline void format_description(Buffer& buffer, const KanbanTask& kanban_task) {
+		std::string markdown;
+		for (const std::string& description_line : kanban_task.description) {
+			markdown += description_line;
+			markdown += '\n';
+		}
+		Buffer html;
+		md_html(markdown.data(), static_cast<MD_SIZE>(markdown.size()), [](const MD_CHAR* text, MD_SIZE size, void* userdata) {
+			static_cast<Buffer*>(userdata)->append(text, text + size);
+		}, &html, MD_DIALECT_GITHUB | MD_FLAG_NOHTML, 0);
+		append_safe_links(buffer, std::string_view(html.data(), html.size()));
+	}
+
+#pragma region Sections
+	static inline void format_label(Buffer& buffer, const KanbanLabel& kanban_label) {
+		fmt::format_to(fmt::appender(buffer), R"(<li id="{}-label-{}" data-color=")", constants::kanban_md, kanban_label.slug_cache.get(kanban_label.name));
+		append_escaped(buffer, kanban_label.color);
+		append(buffer, R"(">)");
+		append_escaped(buffer, kanban_label.name);
+		append(buffer, "</li>\n");
+	}
+
+	static inline void format_list_header(Buffer& buffer, const KanbanList& kanban_list) {
+		fmt::format_to(fmt::appender(buffer), R"(<h3 data-checked="{}" data-counter="{}">)", kanban_list.checked, kanban_list.counter);
+		append_escaped(buffer, kanban_list.name);
+		append(buffer, "</h3>\n");
+	}
+
+	static inline void format_task(Buffer& buffer, const KanbanTask& kanban_task) {
+		fmt::format_to(fmt::appender(buffer), R"(<li id="{0}-task-{1}-{2}" data-checked="{3}" data-counter="{2}"><input type="checkbox" disabled{4}> <span>)",
+			constants::kanban_md,
+			kanban_task.slug_cache.get(kanban_task.name),
+			kanban_task.counter,
+			kanban_task.checked,
+			kanban_task.checked ? " checked" : ""
+		);
+		append_escaped(buffer, kanban_task.name);
+		append(buffer, "</span>\n");
+		if (!kanban_task.description.empty()) {
+			append(buffer, R"(<div class="description">)");
+			format_description(buffer, kanban_task);
+			append(buffer, "</div>\n");
+		}
+		if (!kanban_task.labels.empty()) {
+			append(buffer, R"(<ul class="labels">)");
+			for (const auto& kanban_label : kanban_task.labels) {
+				// The color is left to the label the link points to, a task not being invalidated when a label changes color
+				fmt::format_to(fmt::appender(buffer), R"(<li><a href="#{}-label-{}">)", constants::kanban_md, kanban_label->slug_cache.get(kanban_label->name));
+				append_escaped(buffer, kanban_label->name);
+				append(buffer, "</a></li>");
+			}
+			append(buffer, "</ul>\n");
+		}
+		if (!kanban_task.attachments.empty()) {
+			append(buffer, R"(<ul class="attachments">)");
+			for (const auto& kanban_attachment : kanban_task.attachments) {
+				// An attachment to an unsafe URL is shown as text, with the URL it would go to
+				if (!is_safe_url(kanban_attachment->url)) {
+					append(buffer, "<li>");
+					append_escaped(buffer, kanban_attachment->name);
+					append(buffer, " <code>");
+					append_escaped(buffer, kanban_attachment->url);
+					append(buffer, "</code></li>");
+					continue;
+				}
+				append(buffer, R"(<li><a href=")");
+				append_escaped(buffer, kanban_attachment->url);
+				append(buffer, R"(">)");
+				append_escaped(buffer, kanban_attachment->name);
+				append(buffer, "</a></li>");
+			}
+			append(buffer, "</ul>\n");
+		}
+		if (!kanban_task.checklist.empty()) {
+			append(buffer, R"(<ul class="checklist">)");
+			for (const auto& kanban_checklist_item : kanban_task.checklist) {
+				append(buffer, kanban_checklist_item->checked ? R"(<li><input type="checkbox" disabled checked> )" : R"(<li><input type="checkbox" disabled> )");
+				append_escaped(buffer, kanban_checklist_item->name);
+				append(buffer, "</li>");
+			}
+			append(buffer, "</ul>\n");
+		}
+		append(buffer, "</li>\n");
+	}
+#pragma endregion
+
+	// Appends what render writes, from the node's cache if it is still valid.
+	template <typename Render>
+	static inline void append_cached(Buffer& buffer, KanbanRenderCache& render_cache, Render render) {
+		if (!render_cache.html_valid) {
+			Buffer fragment;
+			render(fragment);
+			render_cache.html.assign(fragment.data(), fragment.size());
+			render_cache.html_valid = true;
+		}
+		append(buffer, render_cache.html);
+	}
+
+	static inline void format(Buffer& buffer, const KanbanBoard& kanban_board) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "html");
+		append(buffer, R"(<div class="kanban_md-board"><h1>)");
+		append_escaped(buffer, !kanban_board.name.empty() ? kanban_board.name : constants::default_board_name);
+		append(buffer, "</h1>\n<p>");
+		append_escaped(buffer, !kanban_board.description.empty() ? kanban_board.description : constants::default_description);
+		append(buffer, "</p>\n");
+
+		if (!kanban_board.labels.empty()) {
+			append(buffer, "<section class=\"labels\"><h2>Labels</h2><ul>\n");
+			for (const auto& kanban_label : kanban_board.labels) {
+				append_cached(buffer, kanban_label->render_cache, [&](Buffer& fragment) { format_label(fragment, *kanban_label); });
+			}
+			append(buffer, "</ul></section>\n");
+		}
+
+		for (const auto& kanban_list : kanban_board.list) {
+			append(buffer, "<section class=\"list\">");
+			append_cached(buffer, kanban_list->render_cache, [&](Buffer& fragment) { format_list_header(fragment, *kanban_list); });
+			append(buffer, "<ul>\n");
+			for (const auto& kanban_task : kanban_list->tasks) {
+				append_cached(buffer, kanban_task->render_cache, [&](Buffer& fragment) { format_task(fragment, *kanban_task); });
+			}
+			append(buffer, "</ul></section>\n");
+		}
+		append(buffer, "</div>\n");
+	}
+
+	static inline std::string format_str(const KanbanBoard& kanban_board) {
+		Buffer buffer;
+		format(buffer, kanban_board);
+		return std::string(buffer.data(), buffer.size());
+	}
+}
@@ -1,30 +1,105 @@
 #pragma once
 
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
 
 #include <yyjson.h>
 
 #include <kanban_markdown/kanban_board.hpp>
 #include <kanban_markdown/constants.hpp>
 #include <kanban_markdown/internal.hpp>
+#include <kanban_markdown/trace.hpp>
+#include <kanban_markdown/utils.hpp>
 
 namespace kanban_markdown::writer::json {
-	inline void format(KanbanBoard kanban_board, yyjson_mut_doc* doc, yyjson_mut_val* root) {
+	struct Flags {
+		// Copy every string into the document. Without it the document refers to the strings of the board,
+		// which must then not be modified or destroyed until the document is written.
+		bool copy_strings = true;
+		// The streaming writer renders lists on this many threads, 0 for one per core.
+		unsigned int threads = 1;
+	};
+
+	static inline yyjson_mut_val* string_value(yyjson_mut_doc* doc, const std::string& string, const Flags& kanban_writer_flags) {
+		if (kanban_writer_flags.copy_strings) {
+			return yyjson_mut_strncpy(doc, string.c_str(), string.length());
+		}
+		return yyjson_mut_strn(doc, string.c_str(), string.length());
+	}
+
+	static inline void add_string(yyjson_mut_doc* doc, yyjson_mut_val* obj, const char* key, const std::string& string, const Flags& kanban_writer_flags) {
+		yyjson_mut_obj_add_val(doc, obj, key, string_value(doc, string, kanban_writer_flags));
+	}
+
+	static inline yyjson_mut_val* format_task(yyjson_mut_doc* doc, const KanbanTask& kanban_task, const Flags& kanban_writer_flags) {
+		yyjson_mut_val* task_obj = yyjson_mut_obj(doc);
+		add_string(doc, task_obj, "name", kanban_task.name, kanban_writer_flags);
+		yyjson_mut_obj_add_bool(doc, task_obj, "checked", kanban_task.checked);
+		yyjson_mut_obj_add_uint(doc, task_obj, "counter", kanban_task.counter);
+
+		yyjson_mut_val* desc_arr = yyjson_mut_arr(doc);
+		for (const auto& desc_line : kanban_task.description) {
+			yyjson_mut_arr_append(desc_arr, string_value(doc, desc_line, kanban_writer_flags));
+		}
+		yyjson_mut_obj_add_val(doc, task_obj, "description", desc_arr);
+
+		yyjson_mut_val* task_labels_arr = yyjson_mut_arr(doc);
+		for (const auto& label : kanban_task.labels) {
+			yyjson_mut_val* task_label_obj = yyjson_mut_obj(doc);
+			add_string(doc, task_label_obj, "name", label->name, kanban_writer_flags);
+			add_string(doc, task_label_obj, "color", label->color, kanban_writer_flags);
+			yyjson_mut_arr_add_val(task_labels_arr, task_label_obj);
+		}
+		yyjson_mut_obj_add_val(doc, task_obj, "labels", task_labels_arr);
+
+		yyjson_mut_val* attachments_arr = yyjson_mut_arr(doc);
+		for (const auto& attachment : kanban_task.attachments) {
+			yyjson_mut_val* attachment_obj = yyjson_mut_obj(doc);
+			add_string(doc, attachment_obj, "name", attachment->name, kanban_writer_flags);
+			add_string(doc, attachment_obj, "url", attachment->url, kanban_writer_flags);
+			yyjson_mut_arr_add_val(attachments_arr, attachment_obj);
+		}
+		yyjson_mut_obj_add_val(doc, task_obj, "attachments", attachments_arr);
+
+		if (!kanban_task.checklist.empty())
+		{
+			yyjson_mut_val* checklist_arr = yyjson_mut_arr(doc);
+			for (const auto& item : kanban_task.checklist) {
+				yyjson_mut_val* checklist_item_obj = yyjson_mut_obj(doc);
+				add_string(doc, checklist_item_obj, "name", item->name, kanban_writer_flags);
+				yyjson_mut_obj_add_bool(doc, checklist_item_obj, "checked", item->checked);
+				yyjson_mut_arr_add_val(checklist_arr, checklist_item_obj);
+			}
+			yyjson_mut_obj_add_val(doc, task_obj, "checklist", checklist_arr);
+		}
+
+		return task_obj;
+	}
+
+	inline void format(const KanbanBoard& kanban_board, yyjson_mut_doc* doc, yyjson_mut_val* root, Flags kanban_writer_flags = Flags()) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "json");
 		if (kanban_board.name.empty()) {
-			yyjson_mut_obj_add_strncpy(doc, root, "name", constants::default_board_name.c_str(), constants::default_board_name.length());
+			add_string(doc, root, "name", constants::default_board_name, kanban_writer_flags);
 		}
 		else {
-			yyjson_mut_obj_add_strncpy(doc, root, "name", kanban_board.name.c_str(), kanban_board.name.length());
+			add_string(doc, root, "name", kanban_board.name, kanban_writer_flags);
 		}
-		yyjson_mut_obj_add_str(doc, root, "description", kanban_board.description.empty() ? constants::default_description.c_str() : kanban_board.description.c_str());
+		add_string(doc, root, "description", kanban_board.description.empty() ? constants::default_description : kanban_board.description, kanban_writer_flags);
 
 		// Properties
 		yyjson_mut_val* properties_obj = yyjson_mut_obj(doc);
-		yyjson_mut_obj_add_strncpy(doc, properties_obj, "color", kanban_board.color.c_str(), kanban_board.color.length());
+		add_string(doc, properties_obj, "color", kanban_board.color, kanban_writer_flags);
 		yyjson_mut_obj_add_uint(doc, properties_obj, "version", kanban_board.version);
 		yyjson_mut_obj_add_uint(doc, properties_obj, "created", kanban_board.created.timestamp());
 		yyjson_mut_obj_add_uint(doc, properties_obj, "last_modified", kanban_board.last_modified.timestamp());
-		yyjson_mut_obj_add_strncpy(doc, properties_obj, "checksum", kanban_board.checksum.c_str(), kanban_board.checksum.length());
+		add_string(doc, properties_obj, "checksum", kanban_board.checksum, kanban_writer_flags);
 
 		yyjson_mut_obj_add_val(doc, root, "properties", properties_obj);
 
@@ -39,7 +114,7 @@ namespace kanban_markdown::writer::json {
 			}
 			yyjson_mut_obj_add_val(doc, tracker_obj, "used_hash", used_hash_arr);
 
-			yyjson_mut_val* name_val = yyjson_mut_strncpy(doc, name.c_str(), name.length());
+			yyjson_mut_val* name_val = string_value(doc, name, kanban_writer_flags);
 			yyjson_mut_obj_add(task_name_tracker_map_obj, name_val, tracker_obj);
 		}
 		yyjson_mut_obj_add_val(doc, root, "task_name_tracker_map", task_name_tracker_map_obj);
@@ -55,7 +130,7 @@ namespace kanban_markdown::writer::json {
 			}
 			yyjson_mut_obj_add_val(doc, tracker_obj, "used_hash", used_hash_arr);
 
-			yyjson_mut_val* name_val = yyjson_mut_strncpy(doc, name.c_str(), name.length());
+			yyjson_mut_val* name_val = string_value(doc, name, kanban_writer_flags);
 			yyjson_mut_obj_add(list_name_tracker_map_obj, name_val, tracker_obj);
 		}
 		yyjson_mut_obj_add_val(doc, root, "list_name_tracker_map", list_name_tracker_map_obj);
@@ -63,13 +138,13 @@ namespace kanban_markdown::writer::json {
 		yyjson_mut_val* labels_arr = yyjson_mut_arr(doc);
 		for (const auto& kanban_label : kanban_board.labels) {
 			yyjson_mut_val* label_obj = yyjson_mut_obj(doc);
-			yyjson_mut_obj_add_strncpy(doc, label_obj, "name", kanban_label->name.c_str(), kanban_label->name.length());
-			yyjson_mut_obj_add_strncpy(doc, label_obj, "color", kanban_label->color.c_str(), kanban_label->color.length());
+			add_string(doc, label_obj, "name", kanban_label->name, kanban_writer_flags);
+			add_string(doc, label_obj, "color", kanban_label->color, kanban_writer_flags);
 
 			yyjson_mut_val* tasks_arr = yyjson_mut_arr(doc);
 			for (const auto& kanban_task : kanban_label->tasks) {
 				yyjson_mut_val* task_obj = yyjson_mut_obj(doc);
-				yyjson_mut_obj_add_strncpy(doc, task_obj, "name", kanban_task->name.c_str(), kanban_task->name.length());
+				add_string(doc, task_obj, "name", kanban_task->name, kanban_writer_flags);
 
 				yyjson_mut_arr_add_val(tasks_arr, task_obj);
 			}
@@ -81,52 +156,12 @@ namespace kanban_markdown::writer::json {
 		yyjson_mut_val* lists_arr = yyjson_mut_arr(doc);
 		for (const auto& kanban_list : kanban_board.list) {
 			yyjson_mut_val* list_obj = yyjson_mut_obj(doc);
-			yyjson_mut_obj_add_strncpy(doc, list_obj, "name", kanban_list->name.c_str(), kanban_list->name.length());
+			add_string(doc, list_obj, "name", kanban_list->name, kanban_writer_flags);
 			yyjson_mut_obj_add_uint(doc, list_obj, "counter", kanban_list->counter);
 
 			yyjson_mut_val* tasks_arr = yyjson_mut_arr(doc);
 			for (const auto& kanban_task : kanban_list->tasks) {
-				yyjson_mut_val* task_obj = yyjson_mut_obj(doc);
-				yyjson_mut_obj_add_strncpy(doc, task_obj, "name", kanban_task->name.c_str(), kanban_task->name.length());
-				yyjson_mut_obj_add_bool(doc, task_obj, "checked", kanban_task->checked);
-				yyjson_mut_obj_add_uint(doc, task_obj, "counter", kanban_task->counter);
-
-				yyjson_mut_val* desc_arr = yyjson_mut_arr(doc);
-				for (const auto& desc_line : kanban_task->description) {
-					yyjson_mut_arr_add_strncpy(doc, desc_arr, desc_line.c_str(), desc_line.length());
-				}
-				yyjson_mut_obj_add_val(doc, task_obj, "description", desc_arr);
-
-				yyjson_mut_val* task_labels_arr = yyjson_mut_arr(doc);
-				for (const auto& label : kanban_task->labels) {
-					yyjson_mut_val* task_label_obj = yyjson_mut_obj(doc);
-					yyjson_mut_obj_add_strncpy(doc, task_label_obj, "name", label->name.c_str(), label->name.length());
-					yyjson_mut_obj_add_strncpy(doc, task_label_obj, "color", label->color.c_str(), label->color.length());
-					yyjson_mut_arr_add_val(task_labels_arr, task_label_obj);
-				}
-				yyjson_mut_obj_add_val(doc, task_obj, "labels", task_labels_arr);
-
-				yyjson_mut_val* attachments_arr = yyjson_mut_arr(doc);
-				for (const auto& attachment : kanban_task->attachments) {
-					yyjson_mut_val* attachment_obj = yyjson_mut_obj(doc);
-					yyjson_mut_obj_add_strncpy(doc, attachment_obj, "name", attachment->name.c_str(), attachment->name.length());
-					yyjson_mut_obj_add_strncpy(doc, attachment_obj, "url", attachment->url.c_str(), attachment->url.length());
-					yyjson_mut_arr_add_val(attachments_arr, attachment_obj);
-				}
-				yyjson_mut_obj_add_val(doc, task_obj, "attachments", attachments_arr);
-
-				if (!kanban_task->checklist.empty())
-				{
-					yyjson_mut_val* checklist_arr = yyjson_mut_arr(doc);
-					for (const auto& item : kanban_task->checklist) {
-						yyjson_mut_val* checklist_item_obj = yyjson_mut_obj(doc);
-						yyjson_mut_obj_add_strncpy(doc, checklist_item_obj, "name", item->name.c_str(), item->name.length());
-						yyjson_mut_obj_add_bool(doc, checklist_item_obj, "checked", item->checked);
-						yyjson_mut_arr_add_val(checklist_arr, checklist_item_obj);
-					}
-					yyjson_mut_obj_add_val(doc, task_obj, "checklist", checklist_arr);
-				}
-
+				yyjson_mut_val* task_obj = format_task(doc, *kanban_task, kanban_writer_flags);
 				yyjson_mut_arr_add_val(tasks_arr, task_obj);
 			}
 			yyjson_mut_obj_add_val(doc, list_obj, "tasks", tasks_arr);
@@ -135,16 +170,285 @@ namespace kanban_markdown::writer::json {
 		yyjson_mut_obj_add_val(doc, root, "lists", lists_arr);
 	}
 
-	inline std::string format_str(KanbanBoard kanban_board) {
+	inline std::string format_str(const KanbanBoard& kanban_board) {
 		yyjson_mut_doc* doc = yyjson_mut_doc_new(nullptr);
 		yyjson_mut_val* root = yyjson_mut_obj(doc);
 		yyjson_mut_doc_set_root(doc, root);
 
-		format(kanban_board, doc, root);
+		// Written right away, so the strings can stay in the board
+		Flags kanban_writer_flags;
+		kanban_writer_flags.copy_strings = false;
+		format(kanban_board, doc, root, kanban_writer_flags);
 
 		const char* json = yyjson_mut_write(doc, 0, nullptr);
 		std::string result(json);
+		free((void*)json);
 		yyjson_mut_doc_free(doc);
 		return result;
 	}
+
+#pragma region Streaming
+	// Writes JSON straight to its output without building a document first, flushing whenever flush_size bytes are buffered.
+	// write is called as write(const char* data, std::size_t size).
+	template <typename Write>
+	class Stream {
+	public:
+		explicit Stream(Write write, std::size_t flush_size = 64 * 1024) : write(std::move(write)), flush_size(flush_size) {
+			this->buffer.reserve(flush_size);
+		}
+
+		~Stream() {
+			this->flush();
+		}
+
+		void raw(std::string_view text) {
+			if (text.size() >= this->flush_size) {
+				this->flush();
+				this->write(text.data(), text.size());
+				return;
+			}
+			this->put(text);
+			this->flush_if_full();
+		}
+
+		void string(std::string_view text) {
+			this->buffer.push_back('"');
+			this->escaped(text);
+			this->buffer.push_back('"');
+			this->flush_if_full();
+		}
+
+		// The inside of a string, so a long string can be written in parts between raw("\"") calls.
+		void escaped(std::string_view text) {
+			static constexpr char hex_digits[] = "0123456789abcdef";
+			const char* run = text.data();
+			const char* last = text.data() + text.size();
+			for (const char* it = run; it != last; ++it) {
+				const unsigned char c = static_cast<unsigned char>(*it);
+				if (c >= 0x20 && c != '"' && c != '\\') {
+					continue;
+				}
+				this->buffer.append(run, it);
+				run = it + 1;
+				switch (c) {
+				case '"': this->put("\\\""); break;
+				case '\\': this->put("\\\\"); break;
+				case '\b': this->put("\\b"); break;
+				case '\f': this->put("\\f"); break;
+				case '\n': this->put("\\n"); break;
+				case '\r': this->put("\\r"); break;
+				case '\t': this->put("\\t"); break;
+				default:
+				{
+					const char escaped[] = { '\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0x0F] };
+					this->buffer.append(escaped, escaped + sizeof(escaped));
+					break;
+				}
+				}
+			}
+			this->buffer.append(run, last);
+			this->flush_if_full();
+		}
+
+		void key(std::string_view name) {
+			this->string(name);
+			this->buffer.push_back(':');
+		}
+
+		void uint(std::uint64_t value) {
+			fmt::format_int digits(value);
+			this->buffer.append(digits.data(), digits.data() + digits.size());
+		}
+
+		void boolean(bool value) {
+			this->raw(value ? std::string_view("true") : std::string_view("false"));
+		}
+
+		void flush() {
+			if (this->buffer.size() > 0) {
+				this->write(this->buffer.data(), this->buffer.size());
+				this->buffer.clear();
+			}
+		}
+
+	private:
+		void put(std::string_view text) {
+			this->buffer.append(text.data(), text.data() + text.size());
+		}
+
+		void flush_if_full() {
+			if (this->buffer.size() >= this->flush_size) {
+				this->flush();
+			}
+		}
+
+		Write write;
+		std::size_t flush_size;
+		fmt::memory_buffer buffer;
+	};
+
+	namespace streaming {
+		template <typename Write>
+		static inline void tracker_map(Stream<Write>& stream, const tsl::robin_map<std::string, DuplicateNameTracker>& name_tracker_map) {
+			stream.raw("{");
+			bool first = true;
+			for (const auto& [name, name_tracker] : name_tracker_map) {
+				if (!first) stream.raw(",");
+				first = false;
+				stream.key(name);
+				stream.raw(R"({"counter":)");
+				stream.uint(name_tracker.counter);
+				stream.raw(R"(,"used_hash":[)");
+				bool first_hash = true;
+				for (const auto& hash : name_tracker.used_hash) {
+					if (!first_hash) stream.raw(",");
+					first_hash = false;
+					stream.uint(hash);
+				}
+				stream.raw("]}");
+			}
+			stream.raw("}");
+		}
+
+		template <typename Write>
+		static inline void task(Stream<Write>& stream, const KanbanTask& kanban_task) {
+			stream.raw(R"({"name":)");
+			stream.string(kanban_task.name);
+			stream.raw(R"(,"checked":)");
+			stream.boolean(kanban_task.checked);
+			stream.raw(R"(,"counter":)");
+			stream.uint(kanban_task.counter);
+
+			stream.raw(R"(,"description":[)");
+			for (std::size_t i = 0; i < kanban_task.description.size(); i++) {
+				if (i > 0) stream.raw(",");
+				stream.string(kanban_task.description[i]);
+			}
+
+			stream.raw(R"(],"labels":[)");
+			for (std::size_t i = 0; i < kanban_task.labels.size(); i++) {
+				if (i > 0) stream.raw(",");
+				stream.raw(R"({"name":)");
+				stream.string(kanban_task.labels[i]->name);
+				stream.raw(R"(,"color":)");
+				stream.string(kanban_task.labels[i]->color);
+				stream.raw("}");
+			}
+
+			stream.raw(R"(],"attachments":[)");
+			for (std::size_t i = 0; i < kanban_task.attachments.size(); i++) {
+				if (i > 0) stream.raw(",");
+				stream.raw(R"({"name":)");
+				stream.string(kanban_task.attachments[i]->name);
+				stream.raw(R"(,"url":)");
+				stream.string(kanban_task.attachments[i]->url);
+				stream.raw("}");
+			}
+			stream.raw("]");
+
+			if (!kanban_task.checklist.empty()) {
+				stream.raw(R"(,"checklist":[)");
+				for (std::size_t i = 0; i < kanban_task.checklist.size(); i++) {
+					if (i > 0) stream.raw(",");
+					stream.raw(R"({"name":)");
+					stream.string(kanban_task.checklist[i]->name);
+					stream.raw(R"(,"checked":)");
+					stream.boolean(kanban_task.checklist[i]->checked);
+					stream.raw("}");
+				}
+				stream.raw("]");
+			}
+			stream.raw("}");
+		}
+
+		template <typename Write>
+		static inline void lists(Stream<Write>& stream, const KanbanBoard& kanban_board, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; i++) {
+				const KanbanList& kanban_list = *kanban_board.list[i];
+				if (i > 0) stream.raw(",");
+				stream.raw(R"({"name":)");
+				stream.string(kanban_list.name);
+				stream.raw(R"(,"counter":)");
+				stream.uint(kanban_list.counter);
+				stream.raw(R"(,"tasks":[)");
+				for (std::size_t j = 0; j < kanban_list.tasks.size(); j++) {
+					if (j > 0) stream.raw(",");
+					task(stream, *kanban_list.tasks[j]);
+				}
+				stream.raw("]}");
+			}
+		}
+	}
+
+	// Writes the same object as format, in one pass and without keeping the whole output in memory.
+	template <typename Write>
+	static inline void format(const KanbanBoard& kanban_board, Stream<Write>& stream, const Flags& kanban_writer_flags = Flags()) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "json");
+		stream.raw(R"({"name":)");
+		stream.string(kanban_board.name.empty() ? constants::default_board_name : kanban_board.name);
+		stream.raw(R"(,"description":)");
+		stream.string(kanban_board.description.empty() ? constants::default_description : kanban_board.description);
+
+		stream.raw(R"(,"properties":{"color":)");
+		stream.string(kanban_board.color);
+		stream.raw(R"(,"version":)");
+		stream.uint(kanban_board.version);
+		stream.raw(R"(,"created":)");
+		stream.uint(kanban_board.created.timestamp());
+		stream.raw(R"(,"last_modified":)");
+		stream.uint(kanban_board.last_modified.timestamp());
+		stream.raw(R"(,"checksum":)");
+		stream.string(kanban_board.checksum);
+		stream.raw("}");
+
+		stream.raw(R"(,"task_name_tracker_map":)");
+		streaming::tracker_map(stream, kanban_board.task_name_tracker_map);
+		stream.raw(R"(,"list_name_tracker_map":)");
+		streaming::tracker_map(stream, kanban_board.list_name_tracker_map);
+
+		stream.raw(R"(,"labels":[)");
+		for (std::size_t i = 0; i < kanban_board.labels.size(); i++) {
+			const KanbanLabel& kanban_label = *kanban_board.labels[i];
+			if (i > 0) stream.raw(",");
+			stream.raw(R"({"name":)");
+			stream.string(kanban_label.name);
+			stream.raw(R"(,"color":)");
+			stream.string(kanban_label.color);
+			stream.raw(R"(,"tasks":[)");
+			for (std::size_t j = 0; j < kanban_label.tasks.size(); j++) {
+				if (j > 0) stream.raw(",");
+				stream.raw(R"({"name":)");
+				stream.string(kanban_label.tasks[j]->name);
+				stream.raw("}");
+			}
+			stream.raw("]}");
+		}
+
+		stream.raw(R"(],"lists":[)");
+		const std::size_t threads = internal::thread_count(kanban_writer_flags.threads);
+		if (threads > 1 && kanban_board.list.size() > 1) {
+			// Each range of lists goes to its own string, then the strings are written in order
+			const std::vector<std::size_t> boundaries = utils::split_lists(kanban_board, threads);
+			std::vector<std::string> chunks(boundaries.size() - 1);
+			internal::parallel_for(chunks.size(), [&](std::size_t chunk) {
+				std::string& output = chunks[chunk];
+				Stream chunk_stream([&output](const char* data, std::size_t size) { output.append(data, size); });
+				streaming::lists(chunk_stream, kanban_board, boundaries[chunk], boundaries[chunk + 1]);
+			});
+			for (const auto& chunk : chunks) {
+				stream.raw(chunk);
+			}
+		}
+		else {
+			streaming::lists(stream, kanban_board, 0, kanban_board.list.size());
+		}
+		stream.raw("]}");
+	}
+
+	// Streams the board to a file, e.g. stdout.
+	static inline void format_file(const KanbanBoard& kanban_board, std::FILE* file, const Flags& kanban_writer_flags = Flags()) {
+		Stream stream([file](const char* data, std::size_t size) { std::fwrite(data, 1, size, file); });
+		format(kanban_board, stream, kanban_writer_flags);
+	}
+#pragma endregion
 }
@@ -1,155 +1,639 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <vector>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 #include <picosha2.h>
 #include <fmt/format.h>
+#include <fmt/compile.h>
 #include <yaml-cpp/yaml.h>
 
 #include <kanban_markdown/kanban_board.hpp>
 #include <kanban_markdown/constants.hpp>
 #include <kanban_markdown/internal.hpp>
+#include <kanban_markdown/trace.hpp>
+#include <kanban_markdown/utils.hpp>
 
 namespace kanban_markdown::writer::markdown {
 	struct Flags {
 		bool github = true;
+		// Lists are rendered on this many threads, 0 for one per core.
+		unsigned int threads = 1;
 	};
 
-	static inline std::string format_str(KanbanBoard kanban_board, Flags kanban_writer_flags = Flags()) {
-		std::string markdown_file;
-		markdown_file += "\r\n";
+	using Buffer = fmt::memory_buffer;
+
+	static inline std::string_view github_tag(const Flags& kanban_writer_flags) {
+		return kanban_writer_flags.github ? std::string_view(constants::github_added_tag) : std::string_view();
+	}
+
+	static inline void append(Buffer& buffer, std::string_view string) {
+		buffer.append(string.data(), string.data() + string.size());
+	}
+
+#pragma region Size Estimate
+	// Rough upper bound of the bytes written for a task, so the buffer only has to be allocated once.
+	static inline std::size_t estimate_task_size(const KanbanTask& kanban_task) {
+		std::size_t size = 96 + kanban_task.name.size() * 2;
+		if (!kanban_task.description.empty()) {
+			size += 32;
+			for (const std::string& description_line : kanban_task.description) {
+				size += description_line.size() + 6;
+			}
+		}
+		if (!kanban_task.labels.empty()) {
+			size += 20;
+			for (const auto& kanban_label : kanban_task.labels) {
+				size += 48 + kanban_label->name.size() * 2;
+			}
+		}
+		if (!kanban_task.attachments.empty()) {
+			size += 24;
+			for (const auto& kanban_attachment : kanban_task.attachments) {
+				size += 16 + kanban_attachment->name.size() + kanban_attachment->url.size();
+			}
+		}
+		if (!kanban_task.checklist.empty()) {
+			size += 20;
+			for (const auto& kanban_checklist_item : kanban_task.checklist) {
+				size += 16 + kanban_checklist_item->name.size();
+			}
+		}
+		return size;
+	}
+
+	static inline std::size_t estimate_size(const KanbanBoard& kanban_board) {
+		std::size_t size = 512 + kanban_board.color.size() + kanban_board.name.size() + kanban_board.description.size();
+		for (const auto& kanban_label : kanban_board.labels) {
+			size += 80 + kanban_label->name.size() * 2 + kanban_label->color.size();
+			for (const auto& kanban_task : kanban_label->tasks) {
+				size += 64 + kanban_task->name.size() * 2;
+			}
+		}
+		for (const auto& kanban_list : kanban_board.list) {
+			size += 80 + kanban_list->name.size();
+			for (const auto& kanban_task : kanban_list->tasks) {
+				size += estimate_task_size(*kanban_task);
+			}
+		}
+		return size;
+	}
+#pragma endregion
+
+#pragma region Sections
+	static inline void format_label(Buffer& buffer, const KanbanLabel& kanban_label, const Flags& kanban_writer_flags) {
+		fmt::format_to(fmt::appender(buffer), FMT_COMPILE(R"(- <span id="{0}-label-{1}" data-color="{2}">{3}</span>{4})"),
+			constants::kanban_md,
+			kanban_label.slug_cache.get(kanban_label.name),
+			kanban_label.color,
+			kanban_label.name,
+			constants::END_OF_MARKDOWN_LINE
+		);
+		for (const auto& kanban_task : kanban_label.tasks) {
+			fmt::format_to(fmt::appender(buffer), FMT_COMPILE(R"(  - [{0}](#{1}{2}-task-{3}-{4}){5})"),
+				kanban_task->name,
+				github_tag(kanban_writer_flags),
+				constants::kanban_md,
+				kanban_task->slug_cache.get(kanban_task->name),
+				kanban_task->counter,
+				constants::END_OF_MARKDOWN_LINE
+			);
+		}
+	}
+
+	static inline void format_list_header(Buffer& buffer, const KanbanList& kanban_list) {
+		fmt::format_to(fmt::appender(buffer), FMT_COMPILE(R"(### <span data-checked="{0}" data-counter="{1}">{2}</span>{3})"),
+			kanban_list.checked,
+			kanban_list.counter,
+			kanban_list.name,
+			constants::END_OF_MARKDOWN_LINE
+		);
+	}
+
+	static inline void format_task(Buffer& buffer, const KanbanTask& kanban_task, const Flags& kanban_writer_flags) {
+		fmt::format_to(fmt::appender(buffer), FMT_COMPILE(R"(- [{0}] <span id="{1}-task-{2}-{3}" data-counter="{3}">{4}</span>{5})"),
+			kanban_task.checked ? 'x' : ' ',
+			constants::kanban_md,
+			kanban_task.slug_cache.get(kanban_task.name),
+			kanban_task.counter,
+			kanban_task.name,
+			constants::END_OF_MARKDOWN_LINE
+		);
+		if (!kanban_task.description.empty()) {
+			append(buffer, "  - **Description**:  ");
+			for (const std::string& description_line : kanban_task.description) {
+				append(buffer, "\r\n  ");
+				append(buffer, description_line);
+				append(buffer, "  ");
+			}
+			append(buffer, constants::END_OF_MARKDOWN_LINE);
+		}
+		if (!kanban_task.labels.empty()) {
+			append(buffer, "  - **Labels**:");
+			append(buffer, constants::END_OF_MARKDOWN_LINE);
+			for (const auto& kanban_label : kanban_task.labels) {
+				fmt::format_to(fmt::appender(buffer), FMT_COMPILE("    - [{0}](#{1}{2}-label-{3}){4}"),
+					kanban_label->name,
+					github_tag(kanban_writer_flags),
+					constants::kanban_md,
+					kanban_label->slug_cache.get(kanban_label->name),
+					constants::END_OF_MARKDOWN_LINE
+				);
+			}
+		}
+		if (!kanban_task.attachments.empty()) {
+			append(buffer, "  - **Attachments**:");
+			append(buffer, constants::END_OF_MARKDOWN_LINE);
+			for (const auto& kanban_attachment : kanban_task.attachments) {
+				fmt::format_to(fmt::appender(buffer), FMT_COMPILE("    - [{0}]({1}){2}"),
+					kanban_attachment->name,
+					kanban_attachment->url,
+					constants::END_OF_MARKDOWN_LINE
+				);
+			}
+		}
+		if (!kanban_task.checklist.empty()) {
+			append(buffer, "  - **Checklist**:");
+			append(buffer, constants::END_OF_MARKDOWN_LINE);
+			for (const auto& kanban_checklist_item : kanban_task.checklist) {
+				fmt::format_to(fmt::appender(buffer), FMT_COMPILE("    - [{0}] {1}{2}"),
+					kanban_checklist_item->checked ? 'x' : ' ',
+					kanban_checklist_item->name,
+					constants::END_OF_MARKDOWN_LINE
+				);
+			}
+		}
+	}
+
+	static inline void format_preamble(Buffer& buffer, const KanbanBoard& kanban_board) {
+		append(buffer, "\r\n");
 #pragma region Note
-		markdown_file += "> [!NOTE]" + constants::END_OF_MARKDOWN_LINE;
-		markdown_file += "> This file is generated by Kanban_MD." + constants::END_OF_MARKDOWN_LINE;
+		append(buffer, "> [!NOTE]");
+		append(buffer, constants::END_OF_MARKDOWN_LINE);
+		append(buffer, "> This file is generated by Kanban_MD.");
+		append(buffer, constants::END_OF_MARKDOWN_LINE);
 #pragma endregion
-		markdown_file += "\r\n";
+		append(buffer, "\r\n");
 #pragma region Header and Description
-		markdown_file += "# " + (!kanban_board.name.empty() ? kanban_board.name : constants::default_board_name) + constants::END_OF_MARKDOWN_LINE;
-		markdown_file += (!kanban_board.description.empty() ? kanban_board.description : constants::default_description) + constants::END_OF_MARKDOWN_LINE;
+		append(buffer, "# ");
+		append(buffer, !kanban_board.name.empty() ? kanban_board.name : constants::default_board_name);
+		append(buffer, constants::END_OF_MARKDOWN_LINE);
+		append(buffer, !kanban_board.description.empty() ? kanban_board.description : constants::default_description);
+		append(buffer, constants::END_OF_MARKDOWN_LINE);
 #pragma endregion
-		markdown_file += "\r\n";
+		append(buffer, "\r\n");
+	}
+
+	static inline void format_lists(Buffer& buffer, const KanbanBoard& kanban_board, std::size_t begin, std::size_t end, const Flags& kanban_writer_flags) {
+		for (std::size_t i = begin; i < end; i++) {
+			const KanbanList& kanban_list = *kanban_board.list[i];
+			format_list_header(buffer, kanban_list);
+			for (const auto& kanban_task : kanban_list.tasks) {
+				format_task(buffer, *kanban_task, kanban_writer_flags);
+			}
+			append(buffer, "\r\n");
+		}
+	}
+
+	static inline void format_body(Buffer& buffer, const KanbanBoard& kanban_board, const Flags& kanban_writer_flags) {
+		format_preamble(buffer, kanban_board);
 #pragma region Labels:
 		if (!kanban_board.labels.empty()) {
-			markdown_file += "## Labels:" + constants::END_OF_MARKDOWN_LINE;
-			for (auto& kanban_label : kanban_board.labels) {
-				const std::string kanban_label_name = kanban_label->name;
-				markdown_file += fmt::format(
-					R"(- <span id="{kanban_md}-label-{id}" data-color="{color}">{name}</span>{eol})",
-					fmt::arg("kanban_md", constants::kanban_md),
-					fmt::arg("id", internal::string_to_id(kanban_label_name)),
-					fmt::arg("color", kanban_label->color),
-					fmt::arg("name", kanban_label_name),
-					fmt::arg("eol", constants::END_OF_MARKDOWN_LINE)
-				);
-				for (auto& kanban_task : kanban_label->tasks) {
-					const std::string kanban_task_name = kanban_task->name;
-					markdown_file += fmt::format(
-						R"(  - [{name}](#{github}{kanban_md}-task-{id}-{counter}){eol})",
-						fmt::arg("github", kanban_writer_flags.github ? constants::github_added_tag : ""),
-						fmt::arg("kanban_md", constants::kanban_md),
-						fmt::arg("id", internal::string_to_id(kanban_task_name)),
-						fmt::arg("counter", kanban_task->counter),
-						fmt::arg("name", kanban_task_name),
-						fmt::arg("eol", constants::END_OF_MARKDOWN_LINE)
-					);
-				}
+			append(buffer, "## Labels:");
+			append(buffer, constants::END_OF_MARKDOWN_LINE);
+			for (const auto& kanban_label : kanban_board.labels) {
+				format_label(buffer, *kanban_label, kanban_writer_flags);
 			}
-			markdown_file += "\r\n";
+			append(buffer, "\r\n");
 		}
 #pragma endregion
 #pragma region Board
 		if (!kanban_board.list.empty()) {
-			markdown_file += "## Board:" + constants::END_OF_MARKDOWN_LINE;
-			markdown_file += "\r\n";
-			for (auto& kanban_list : kanban_board.list) {
-				markdown_file += fmt::format(R"(### <span data-checked="{checked}" data-counter="{counter}">{name}</span>{eol})",
-					fmt::arg("checked", kanban_list->checked),
-					fmt::arg("counter", kanban_list->counter),
-					fmt::arg("name", kanban_list->name),
-					fmt::arg("eol", constants::END_OF_MARKDOWN_LINE)
-				);
-				for (auto& kanban_task : kanban_list->tasks) {
-					markdown_file += fmt::format(R"(- [{checked}] <span id="{kanban_md}-task-{id}-{counter}" data-counter="{counter}">{name}</span>{eol})",
-						fmt::arg("checked", kanban_task->checked ? 'x' : ' '),
-						fmt::arg("kanban_md", constants::kanban_md),
-						fmt::arg("id", internal::string_to_id(kanban_task->name)),
-						fmt::arg("counter", kanban_task->counter),
-						fmt::arg("name", kanban_task->name),
-						fmt::arg("eol", constants::END_OF_MARKDOWN_LINE)
-					);
-					if (!kanban_task->description.empty()) {
-						std::string description_string = "  - **Description**:  ";
-						for (std::string description_line : kanban_task->description) {
-							description_string += "\r\n  " + description_line + "  ";
+			append(buffer, "## Board:");
+			append(buffer, constants::END_OF_MARKDOWN_LINE);
+			append(buffer, "\r\n");
+			const std::size_t threads = internal::thread_count(kanban_writer_flags.threads);
+			if (threads > 1 && kanban_board.list.size() > 1) {
+				// Labels are shared between lists, their slugs are computed here so the threads only read them
+				for (const auto& kanban_list : kanban_board.list) {
+					for (const auto& kanban_task : kanban_list->tasks) {
+						for (const auto& kanban_label : kanban_task->labels) {
+							kanban_label->slug_cache.get(kanban_label->name);
 						}
-						markdown_file += description_string + constants::END_OF_MARKDOWN_LINE;
 					}
-					if (!kanban_task->labels.empty()) {
-						markdown_file += "  - **Labels**:" + constants::END_OF_MARKDOWN_LINE;
-						for (auto& kanban_label : kanban_task->labels) {
-							const std::string kanban_label_name = kanban_label->name;
-							markdown_file += fmt::format(
-								"    - [{name}](#{github}{kanban_md}-label-{id}){eol}",
-								fmt::arg("github", kanban_writer_flags.github ? constants::github_added_tag : ""),
-								fmt::arg("kanban_md", constants::kanban_md),
-								fmt::arg("id", internal::string_to_id(kanban_label_name)),
-								fmt::arg("name", kanban_label_name),
-								fmt::arg("eol", constants::END_OF_MARKDOWN_LINE)
-							);
-						}
+				}
+				// Each range of lists goes to its own buffer, then the buffers are joined in order
+				const std::vector<std::size_t> boundaries = utils::split_lists(kanban_board, threads);
+				std::vector<Buffer> chunks(boundaries.size() - 1);
+				internal::parallel_for(chunks.size(), [&](std::size_t chunk) {
+					format_lists(chunks[chunk], kanban_board, boundaries[chunk], boundaries[chunk + 1], kanban_writer_flags);
+				});
+				for (const auto& chunk : chunks) {
+					buffer.append(chunk.data(), chunk.data() + chunk.size());
+				}
+			}
+			else {
+				format_lists(buffer, kanban_board, 0, kanban_board.list.size(), kanban_writer_flags);
+			}
+			append(buffer, "\r\n");
+		}
+#pragma endregion
+	}
+#pragma endregion
+
+#pragma region Properties
+	// yaml-cpp double quotes a "#RRGGBB" color and leaves it unescaped, anything else goes through the emitter.
+	static inline bool is_template_color(const std::string& color) {
+		if (color.size() < 2 || color[0] != '#') {
+			return false;
+		}
+		return std::all_of(color.begin() + 1, color.end(), [](char character) {
+			return (character >= '0' && character <= '9') || (character >= 'A' && character <= 'Z') || (character >= 'a' && character <= 'z');
+		});
+	}
+
+	// Writes the front matter with a zeroed checksum and returns the offset of the checksum in the buffer.
+	// The lines match what YAML::Node emits for the same properties.
+	static inline std::size_t format_properties(Buffer& buffer, const KanbanBoard& kanban_board) {
+		append(buffer, "---\r\n");
+		if (is_template_color(kanban_board.color)) {
+			fmt::format_to(fmt::appender(buffer), FMT_COMPILE("Color: \"{}\"\n"), kanban_board.color);
+		}
+		else {
+			YAML::Node properties;
+			properties["Color"] = kanban_board.color;
+			std::ostringstream oss;
+			oss << properties;
+			append(buffer, oss.str());
+			append(buffer, "\n");
+		}
+		fmt::format_to(fmt::appender(buffer), FMT_COMPILE("Version: {}\nCreated: {}\nLast Modified: {}\n"),
+			kanban_board.version,
+			kanban_board.created.str(constants::time_format),
+			kanban_board.last_modified.str(constants::time_format)
+		);
+		// Boards using the original checksum are written without the marker so their files do not change
+		if (kanban_board.checksum_version != constants::checksum_version_sha256) {
+			fmt::format_to(fmt::appender(buffer), FMT_COMPILE("Checksum Version: {}\n"), kanban_board.checksum_version);
+		}
+		append(buffer, "Checksum: ");
+		const std::size_t checksum_offset = buffer.size();
+		buffer.resize(checksum_offset + picosha2::k_digest_size * 2);
+		append(buffer, "\r\n");
+		append(buffer, "---\r\n");
+		return checksum_offset;
+	}
+#pragma endregion
+
+#pragma region Checksum
+	using Digest = std::array<unsigned char, picosha2::k_digest_size>;
+
+	static inline Digest digest_of(const char* first, const char* last) {
+		picosha2::hash256_one_by_one hasher;
+		hasher.process(first, last);
+		hasher.finish();
+		Digest digest;
+		hasher.get_hash_bytes(digest.begin(), digest.end());
+		return digest;
+	}
+
+	// Writes the hex digest over the zeroed checksum.
+	static inline void write_checksum(char* out, const Digest& digest) {
+		static constexpr char hex_digits[] = "0123456789abcdef";
+		for (unsigned char byte : digest) {
+			*out++ = hex_digits[byte >> 4];
+			*out++ = hex_digits[byte & 0x0F];
+		}
+	}
+#pragma endregion
+
+#pragma region Segmented
+	// A run of the body remembered between calls of the cached format_str.
+	// key is the list for list segments, &KanbanBoard::labels for the labels and nullptr for plain text, which is kept in text.
+	struct CacheSegment {
+		const void* key = nullptr;
+		std::string text;
+		std::vector<const void*> nodes;
+		// Checksum Version 1: the SHA-256 state after this segment
+		picosha2::hash256_one_by_one hasher;
+		// Checksum Version 2: the digest of this segment
+		Digest digest;
+	};
+
+	// State kept by the caller between calls of the cached format_str. The rendered fragments live on the nodes themselves,
+	// this only remembers the shape of the last body so the checksum can skip the segments that did not change.
+	struct Cache {
+		std::vector<CacheSegment> segments;
+		unsigned int checksum_version = 0;
+		std::size_t size = 0;
+	};
+
+	// The body is split in segments: the preamble, the labels, the board header, one per list and the trailing line.
+	// Each segment is split in pieces, a piece being a label, list header or task fragment or some literal text between them.
+	//
+	// Checksum Version 1 is the SHA-256 of the whole body.
+	// Checksum Version 2 is a tree of SHA-256 digests following the pieces: a segment digest is the SHA-256 of the concatenated digests
+	// of its pieces and the checksum is the SHA-256 of the concatenated segment digests. Editing a task only hashes its fragment,
+	// the digests of its list and the segment digests again.
+	namespace segmented {
+		struct Piece {
+			std::size_t end = 0;
+			KanbanRenderCache* render_cache = nullptr;
+		};
+
+		struct Segment {
+			const void* key = nullptr;
+			std::size_t begin = 0;
+			std::size_t end = 0;
+			bool rendered = false;
+			std::vector<const void*> nodes;
+			std::vector<Piece> pieces;
+		};
+
+		struct Context {
+			Buffer& buffer;
+			const Flags& kanban_writer_flags;
+			bool use_node_cache = false;
+			bool record_pieces = false;
+			std::vector<Segment> segments;
+		};
+
+		static inline Segment& begin_segment(Context& context, const void* key) {
+			Segment& segment = context.segments.emplace_back();
+			segment.key = key;
+			segment.begin = context.buffer.size();
+			return segment;
+		}
+
+		static inline void end_piece(Context& context, KanbanRenderCache* render_cache = nullptr) {
+			if (context.record_pieces) {
+				context.segments.back().pieces.push_back(Piece{ context.buffer.size(), render_cache });
+			}
+		}
+
+		static inline void end_segment(Context& context) {
+			Segment& segment = context.segments.back();
+			if (segment.pieces.empty() || segment.pieces.back().end != context.buffer.size()) {
+				end_piece(context);
+			}
+			segment.end = context.buffer.size();
+		}
+
+		template <typename Render>
+		static inline void append_fragment(Context& context, KanbanRenderCache& render_cache, Render render) {
+			Segment& segment = context.segments.back();
+			if (!context.use_node_cache) {
+				render();
+				segment.rendered = true;
+				end_piece(context);
+				return;
+			}
+			const bool github = context.kanban_writer_flags.github;
+			if (render_cache.markdown_valid && render_cache.markdown_github == github) {
+				append(context.buffer, render_cache.markdown);
+			}
+			else {
+				const std::size_t begin = context.buffer.size();
+				render();
+				render_cache.markdown.assign(context.buffer.data() + begin, context.buffer.size() - begin);
+				render_cache.markdown_github = github;
+				render_cache.markdown_valid = true;
+				render_cache.markdown_digest_valid = false;
+				segment.rendered = true;
+			}
+			end_piece(context, &render_cache);
+		}
+
+		static inline void format_body(Context& context, const KanbanBoard& kanban_board) {
+			Buffer& buffer = context.buffer;
+			const Flags& kanban_writer_flags = context.kanban_writer_flags;
+
+			begin_segment(context, nullptr);
+			format_preamble(buffer, kanban_board);
+			end_segment(context);
+
+			if (!kanban_board.labels.empty()) {
+				Segment& segment = begin_segment(context, &kanban_board.labels);
+				append(buffer, "## Labels:");
+				append(buffer, constants::END_OF_MARKDOWN_LINE);
+				end_piece(context);
+				for (const auto& kanban_label : kanban_board.labels) {
+					append_fragment(context, kanban_label->render_cache, [&]() { format_label(buffer, *kanban_label, kanban_writer_flags); });
+					segment.nodes.push_back(kanban_label.get());
+				}
+				append(buffer, "\r\n");
+				end_segment(context);
+			}
+			if (!kanban_board.list.empty()) {
+				begin_segment(context, nullptr);
+				append(buffer, "## Board:");
+				append(buffer, constants::END_OF_MARKDOWN_LINE);
+				append(buffer, "\r\n");
+				end_segment(context);
+
+				for (const auto& kanban_list : kanban_board.list) {
+					Segment& segment = begin_segment(context, kanban_list.get());
+					segment.nodes.reserve(kanban_list->tasks.size());
+					if (context.record_pieces) {
+						segment.pieces.reserve(kanban_list->tasks.size() + 2);
 					}
-					if (!kanban_task->attachments.empty()) {
-						markdown_file += "  - **Attachments**:" + constants::END_OF_MARKDOWN_LINE;
-						for (auto& kanban_attachment : kanban_task->attachments) {
-							markdown_file += fmt::format(
-								"    - [{name}]({url}){eol}",
-								fmt::arg("name", kanban_attachment->name),
-								fmt::arg("url", kanban_attachment->url),
-								fmt::arg("eol", constants::END_OF_MARKDOWN_LINE)
-							);
-						}
+					append_fragment(context, kanban_list->render_cache, [&]() { format_list_header(buffer, *kanban_list); });
+					for (const auto& kanban_task : kanban_list->tasks) {
+						append_fragment(context, kanban_task->render_cache, [&]() { format_task(buffer, *kanban_task, kanban_writer_flags); });
+						segment.nodes.push_back(kanban_task.get());
 					}
-					if (!kanban_task->checklist.empty()) {
-						markdown_file += "  - **Checklist**:" + constants::END_OF_MARKDOWN_LINE;
-						for (auto& kanban_checklist_item : kanban_task->checklist) {
-							markdown_file += fmt::format(
-								"    - [{checked}] {name}{eol}",
-								fmt::arg("checked", kanban_checklist_item->checked ? 'x' : ' '),
-								fmt::arg("name", kanban_checklist_item->name),
-								fmt::arg("eol", constants::END_OF_MARKDOWN_LINE)
-							);
+					append(buffer, "\r\n");
+					end_segment(context);
+				}
+
+				begin_segment(context, nullptr);
+				append(buffer, "\r\n");
+				end_segment(context);
+			}
+		}
+
+		static inline bool is_unchanged(const Cache& cache, std::size_t index, const Segment& segment, const Buffer& buffer) {
+			if (segment.rendered || index >= cache.segments.size()) {
+				return false;
+			}
+			const CacheSegment& cache_segment = cache.segments[index];
+			if (cache_segment.key != segment.key || cache_segment.nodes != segment.nodes) {
+				return false;
+			}
+			if (segment.key == nullptr) {
+				return std::string_view(buffer.data() + segment.begin, segment.end - segment.begin) == cache_segment.text;
+			}
+			return true;
+		}
+
+		static inline Digest piece_digest(const Buffer& buffer, std::size_t begin, const Piece& piece) {
+			if (piece.render_cache == nullptr) {
+				return digest_of(buffer.data() + begin, buffer.data() + piece.end);
+			}
+			KanbanRenderCache& render_cache = *piece.render_cache;
+			if (!render_cache.markdown_digest_valid) {
+				Digest digest = digest_of(buffer.data() + begin, buffer.data() + piece.end);
+				std::copy(digest.begin(), digest.end(), render_cache.markdown_digest.begin());
+				render_cache.markdown_digest_valid = true;
+			}
+			Digest digest;
+			std::copy(render_cache.markdown_digest.begin(), render_cache.markdown_digest.end(), digest.begin());
+			return digest;
+		}
+
+		static inline Digest segment_digest(const Buffer& buffer, const Segment& segment) {
+			picosha2::hash256_one_by_one hasher;
+			std::size_t begin = segment.begin;
+			for (const Piece& piece : segment.pieces) {
+				const Digest digest = piece_digest(buffer, begin, piece);
+				hasher.process(digest.begin(), digest.end());
+				begin = piece.end;
+			}
+			hasher.finish();
+			Digest digest;
+			hasher.get_hash_bytes(digest.begin(), digest.end());
+			return digest;
+		}
+
+		// Computes the checksum of the body, reusing whatever the cache remembers of the segments that did not change, and updates the cache.
+		static inline Digest checksum(Context& context, Cache& cache, unsigned int checksum_version) {
+			const Buffer& buffer = context.buffer;
+			std::vector<Segment>& segments = context.segments;
+			if (cache.checksum_version != checksum_version) {
+				cache.segments.clear();
+				cache.checksum_version = checksum_version;
+			}
+
+			std::vector<bool> unchanged(segments.size());
+			for (std::size_t i = 0; i < segments.size(); i++) {
+				unchanged[i] = is_unchanged(cache, i, segments[i], buffer);
+			}
+
+			picosha2::hash256_one_by_one hasher;
+			std::size_t first_changed = 0;
+			if (checksum_version == constants::checksum_version_sha256) {
+				// Resume after the last segment that is the same as in the previous call
+				while (first_changed < segments.size() && unchanged[first_changed]) {
+					first_changed++;
+				}
+				if (first_changed > 0) {
+					hasher = cache.segments[first_changed - 1].hasher;
+				}
+			}
+
+			cache.segments.resize(segments.size());
+			const std::size_t threads = internal::thread_count(context.kanban_writer_flags.threads);
+			if (checksum_version != constants::checksum_version_sha256 && threads > 1) {
+				// Segments only share the buffer, which is not modified anymore, so their digests can be computed side by side
+				const std::size_t chunks = std::min(threads, segments.size());
+				internal::parallel_for(chunks, [&](std::size_t chunk) {
+					for (std::size_t i = chunk; i < segments.size(); i += chunks) {
+						if (!unchanged[i]) {
+							cache.segments[i].digest = segment_digest(buffer, segments[i]);
 						}
 					}
+				});
+			}
+			else if (checksum_version != constants::checksum_version_sha256) {
+				for (std::size_t i = 0; i < segments.size(); i++) {
+					if (!unchanged[i]) {
+						cache.segments[i].digest = segment_digest(buffer, segments[i]);
+					}
 				}
-				markdown_file += "\r\n";
 			}
-			markdown_file += "\r\n";
+			for (std::size_t i = 0; i < segments.size(); i++) {
+				Segment& segment = segments[i];
+				CacheSegment& cache_segment = cache.segments[i];
+				if (checksum_version == constants::checksum_version_sha256) {
+					if (i < first_changed) {
+						continue;
+					}
+					hasher.process(buffer.data() + segment.begin, buffer.data() + segment.end);
+					cache_segment.hasher = hasher;
+				}
+				else {
+					hasher.process(cache_segment.digest.begin(), cache_segment.digest.end());
+				}
+				if (!unchanged[i]) {
+					cache_segment.key = segment.key;
+					cache_segment.nodes = std::move(segment.nodes);
+					if (segment.key == nullptr) {
+						cache_segment.text.assign(buffer.data() + segment.begin, segment.end - segment.begin);
+					}
+				}
+			}
+			hasher.finish();
+			Digest digest;
+			hasher.get_hash_bytes(digest.begin(), digest.end());
+			return digest;
+		}
+
+		// Writes the whole file to the buffer and returns the offset of the checksum.
+		static inline std::size_t write(Buffer& buffer, const KanbanBoard& kanban_board, Cache& cache, const Flags& kanban_writer_flags, bool use_node_cache) {
+			Context context{ buffer, kanban_writer_flags };
+			context.use_node_cache = use_node_cache;
+			context.record_pieces = kanban_board.checksum_version != constants::checksum_version_sha256;
+			context.segments.reserve(kanban_board.list.size() + 4);
+
+			const std::size_t checksum_offset = format_properties(buffer, kanban_board);
+			format_body(context, kanban_board);
+			KANBAN_MARKDOWN_TRACE_SCOPE("writer", "hash");
+			write_checksum(buffer.data() + checksum_offset, checksum(context, cache, kanban_board.checksum_version));
+			return checksum_offset;
 		}
+	}
 #pragma endregion
-#pragma region Properties
-		std::string properties_string;
-		properties_string += "---\r\n";
-		YAML::Node properties;
-		properties["Color"] = kanban_board.color;
-		properties["Version"] = kanban_board.version;
-		properties["Created"] = kanban_board.created.str(constants::time_format);
-		properties["Last Modified"] = kanban_board.last_modified.str(constants::time_format);
+
+	static inline std::string format_str(const KanbanBoard& kanban_board, Flags kanban_writer_flags = Flags()) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "markdown");
+		Buffer buffer;
+		buffer.reserve(estimate_size(kanban_board));
+		if (kanban_board.checksum_version != constants::checksum_version_sha256) {
+			Cache cache;
+			segmented::write(buffer, kanban_board, cache, kanban_writer_flags, false);
+			return fmt::to_string(buffer);
+		}
+
+		const std::size_t checksum_offset = format_properties(buffer, kanban_board);
+		const std::size_t body_offset = buffer.size();
+		format_body(buffer, kanban_board, kanban_writer_flags);
 
 		// Get the checksum of the file without the properties
-		std::vector<unsigned char> hash(picosha2::k_digest_size);
-		picosha2::hash256(markdown_file.begin(), markdown_file.end(), hash.begin(), hash.end());
-		std::string hex_str = picosha2::bytes_to_hex_string(hash.begin(), hash.end());
-		properties["Checksum"] = hex_str;
-
-		std::ostringstream oss;
-		oss << properties;
-		properties_string += oss.str() + "\r\n";
-		properties_string += "---\r\n";
-		markdown_file = properties_string + markdown_file;
-#pragma endregion
-		return markdown_file;
+		write_checksum(buffer.data() + checksum_offset, digest_of(buffer.data() + body_offset, buffer.data() + buffer.size()));
+		return fmt::to_string(buffer);
+	}
+
+	// Same output as format_str, but labels, lists and tasks are only rendered again after they were invalidated
+	// (see utils::invalidate_task and utils::invalidate_label) and only the changed parts of the body are hashed again.
+	static inline std::string format_str(const KanbanBoard& kanban_board, Cache& cache, Flags kanban_writer_flags = Flags()) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "markdown");
+		Buffer buffer;
+		buffer.reserve(cache.size > 0 ? cache.size + cache.size / 8 : estimate_size(kanban_board));
+		segmented::write(buffer, kanban_board, cache, kanban_writer_flags, true);
+		cache.size = buffer.size();
+		return fmt::to_string(buffer);
+	}
+
+	// The checksum format_str would write for the board.
+	static inline std::string checksum(const KanbanBoard& kanban_board, Flags kanban_writer_flags = Flags()) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "checksum");
+		Buffer buffer;
+		buffer.reserve(estimate_size(kanban_board));
+		Cache cache;
+		const std::size_t checksum_offset = segmented::write(buffer, kanban_board, cache, kanban_writer_flags, false);
+		return std::string(buffer.data() + checksum_offset, picosha2::k_digest_size * 2);
+	}
+
+	// Whether the checksum read with the board matches the board, rendered with the flags it was written with.
+	// Checksum Version 1 is checked by the reader against the file as it was, this renders the board again.
+	static inline bool verify(const KanbanBoard& kanban_board, Flags kanban_writer_flags = Flags()) {
+		if (kanban_board.checksum_version == constants::checksum_version_sha256) {
+			return kanban_board.checksum_verified;
+		}
+		return checksum(kanban_board, kanban_writer_flags) == kanban_board.checksum;
 	}
 }
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include <kanban_markdown/kanban_board.hpp>
+#include <kanban_markdown/trace.hpp>
+#include <kanban_markdown/writer/json.hpp>
+
+// One flat record per task, for tools that only want the tasks and not the nested board:
+//   list, counter, name, checked, labels, checklist_done, checklist_total, attachments
+// As NDJSON every record is an object on its own line and labels is an array of names.
+// As CSV the first line is the header and labels are joined with ';'.
+namespace kanban_markdown::writer::tasks {
+	enum class Format {
+		ndjson,
+		csv,
+	};
+
+	struct Flags {
+		Format format = Format::ndjson;
+	};
+
+	namespace internal {
+		// Quoted only if it holds a separator, a quote or a line break, quotes being doubled.
+		template <typename Write>
+		static inline void csv_field(json::Stream<Write>& stream, std::string_view field) {
+			if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+				stream.raw(field);
+				return;
+			}
+			stream.raw("\"");
+			std::size_t begin = 0;
+			for (std::size_t quote = field.find('"'); quote != std::string_view::npos; quote = field.find('"', begin)) {
+				stream.raw(field.substr(begin, quote + 1 - begin));
+				stream.raw("\"");
+				begin = quote + 1;
+			}
+			stream.raw(field.substr(begin));
+			stream.raw("\"");
+		}
+
+		template <typename Write>
+		static inline void csv_labels(json::Stream<Write>& stream, const KanbanTask& kanban_task) {
+			bool quoted = false;
+			for (const auto& kanban_label : kanban_task.labels) {
+				if (kanban_label->name.find_first_of(",\"\r\n") != std::string::npos) {
+					quoted = true;
+					break;
+				}
+			}
+			if (!quoted) {
+				for (std::size_t i = 0; i < kanban_task.labels.size(); i++) {
+					if (i > 0) stream.raw(";");
+					stream.raw(kanban_task.labels[i]->name);
+				}
+				return;
+			}
+			std::string labels;
+			for (std::size_t i = 0; i < kanban_task.labels.size(); i++) {
+				if (i > 0) labels += ';';
+				labels += kanban_task.labels[i]->name;
+			}
+			csv_field(stream, labels);
+		}
+
+		static inline std::size_t checklist_done(const KanbanTask& kanban_task) {
+			std::size_t done = 0;
+			for (const auto& kanban_checklist_item : kanban_task.checklist) {
+				if (kanban_checklist_item->checked) {
+					done++;
+				}
+			}
+			return done;
+		}
+
+		template <typename Write>
+		static inline void ndjson_record(json::Stream<Write>& stream, const KanbanList& kanban_list, const KanbanTask& kanban_task) {
+			stream.raw(R"({"list":)");
+			stream.string(kanban_list.name);
+			stream.raw(R"(,"counter":)");
+			stream.uint(kanban_task.counter);
+			stream.raw(R"(,"name":)");
+			stream.string(kanban_task.name);
+			stream.raw(R"(,"checked":)");
+			stream.boolean(kanban_task.checked);
+			stream.raw(R"(,"labels":[)");
+			for (std::size_t i = 0; i < kanban_task.labels.size(); i++) {
+				if (i > 0) stream.raw(",");
+				stream.string(kanban_task.labels[i]->name);
+			}
+			stream.raw(R"(],"checklist_done":)");
+			stream.uint(checklist_done(kanban_task));
+			stream.raw(R"(,"checklist_total":)");
+			stream.uint(kanban_task.checklist.size());
+			stream.raw(R"(,"attachments":)");
+			stream.uint(kanban_task.attachments.size());
+			stream.raw("}\n");
+		}
+
+		template <typename Write>
+		static inline void csv_record(json::Stream<Write>& stream, const KanbanList& kanban_list, const KanbanTask& kanban_task) {
+			csv_field(stream, kanban_list.name);
+			stream.raw(",");
+			stream.uint(kanban_task.counter);
+			stream.raw(",");
+			csv_field(stream, kanban_task.name);
+			stream.raw(",");
+			stream.boolean(kanban_task.checked);
+			stream.raw(",");
+			csv_labels(stream, kanban_task);
+			stream.raw(",");
+			stream.uint(checklist_done(kanban_task));
+			stream.raw(",");
+			stream.uint(kanban_task.checklist.size());
+			stream.raw(",");
+			stream.uint(kanban_task.attachments.size());
+			stream.raw("\r\n");
+		}
+	}
+
+	// Records are written to the stream as they are produced, so memory use does not grow with the board.
+	template <typename Write>
+	static inline void format(const KanbanBoard& kanban_board, json::Stream<Write>& stream, const Flags& kanban_writer_flags = Flags()) {
+		KANBAN_MARKDOWN_TRACE_SCOPE("writer", "tasks");
+		if (kanban_writer_flags.format == Format::csv) {
+			stream.raw("list,counter,name,checked,labels,checklist_done,checklist_total,attachments\r\n");
+		}
+		for (const auto& kanban_list : kanban_board.list) {
+			for (const auto& kanban_task : kanban_list->tasks) {
+				if (kanban_writer_flags.format == Format::csv) {
+					internal::csv_record(stream, *kanban_list, *kanban_task);
+				}
+				else {
+					internal::ndjson_record(stream, *kanban_list, *kanban_task);
+				}
+			}
+		}
+	}
+
+	// Streams the records to a file, e.g. stdout.
+	static inline void format_file(const KanbanBoard& kanban_board, std::FILE* file, const Flags& kanban_writer_flags = Flags()) {
+		json::Stream stream([file](const char* data, std::size_t size) { std::fwrite(data, 1, size, file); });
+		format(kanban_board, stream, kanban_writer_flags);
+	}
+
+	static inline std::string format_str(const KanbanBoard& kanban_board, const Flags& kanban_writer_flags = Flags()) {
+		std::string output;
+		{
+			json::Stream stream([&output](const char* data, std::size_t size) { output.append(data, size); });
+			format(kanban_board, stream, kanban_writer_flags);
+		}
+		return output;
+	}
+}
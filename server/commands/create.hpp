@@ -50,6 +50,7 @@ namespace server::commands
 			kanban_list->name = name_str;
 			kanban_list->checked = yyjson_get_bool(checked);
 			this->kanban_board->list.push_back(kanban_list);
+			this->change.list = kanban_list;
 		}
 
 		void editBoardLabels() final {
@@ -72,6 +73,7 @@ namespace server::commands
 			kanban_label->color = yyjson_get_string_object(color);
 			kanban_label->name = name_str;
 			this->kanban_board->labels.push_back(kanban_label);
+			this->change.label = kanban_label;
 		}
 
 		void visitList(std::vector<std::shared_ptr<kanban_markdown::KanbanList>>::iterator kanban_list_iterator) final {
@@ -146,6 +148,7 @@ namespace server::commands
 				}
 				kanban_task->labels.push_back(kanban_label);
 				kanban_label->tasks.push_back(kanban_task);
+				kanban_label->render_cache.invalidate();
 			}
 
 			yyjson_val* attachment;
@@ -173,6 +176,7 @@ namespace server::commands
 			}
 
 			kanban_list->tasks.push_back(kanban_task);
+			this->change.task = kanban_task;
 		}
 
 		void visitTask(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::vector<std::shared_ptr<kanban_markdown::KanbanTask>>::iterator kanban_task_iterator) final {
@@ -222,6 +226,8 @@ namespace server::commands
 			}
 			kanban_task->labels.push_back(kanban_label);
 			kanban_label->tasks.push_back(kanban_task);
+			kanban_markdown::utils::invalidate_task(*kanban_task);
+			this->change.label = kanban_label;
 		}
 		void editTaskAttachments(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task) final {
 			yyjson_val* value = (yyjson_val*)userdata;
@@ -244,6 +250,7 @@ namespace server::commands
 			kanban_attachment->name = attachment_name;
 			kanban_attachment->url = attachment_url;
 			kanban_task->attachments.push_back(kanban_attachment);
+			kanban_task->render_cache.invalidate();
 		}
 		void editTaskChecklist(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task) final {
 			yyjson_val* value = (yyjson_val*)this->userdata;
@@ -266,6 +273,7 @@ namespace server::commands
 			kanban_checklist_item->name = checklist_item_name;
 			kanban_checklist_item->checked = checklist_item_checked;
 			kanban_task->checklist.push_back(kanban_checklist_item);
+			kanban_task->render_cache.invalidate();
 		}
 
 		void visitTaskLabel(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::vector<std::shared_ptr<kanban_markdown::KanbanLabel>>::iterator kanban_label_iterator) final {
@@ -315,7 +323,7 @@ namespace server::commands
 		}
 	};
 
-	void command_create(KanbanTuple& kanban_tuple, yyjson_val* command)
+	Change command_create(KanbanTuple& kanban_tuple, yyjson_val* command)
 	{
 		yyjson_val* path = yyjson_obj_get(command, "path");
 		if (path == NULL)
@@ -331,5 +339,6 @@ namespace server::commands
 
 		CreateCommandVisitor visitor(&kanban_tuple.kanban_board, path_str, value);
 		visitor.run();
+		return visitor.changed();
 	}
 }
@@ -43,6 +43,7 @@ namespace server::commands
 				for (auto& kanban_label : kanban_task->labels) {
 					kanban_label->tasks.erase(std::remove_if(kanban_label->tasks.begin(), kanban_label->tasks.end(), [&kanban_task](const std::shared_ptr<kanban_markdown::KanbanTask>& x)
 						{ return *x == *kanban_task; }), kanban_label->tasks.end());
+					kanban_label->render_cache.invalidate();
 				}
 				auto& task_name_tracker = this->kanban_board->task_name_tracker_map[kanban_task->name];
 				task_name_tracker.removeHash(kanban_task->counter);
@@ -50,6 +51,7 @@ namespace server::commands
 			auto& list_name_tracker = this->kanban_board->list_name_tracker_map[kanban_list->name];
 			list_name_tracker.removeHash(kanban_list->counter);
 			this->kanban_board->list.erase(kanban_list_iterator);
+			this->change.list.reset();
 		}
 
 		void editListName(std::shared_ptr<kanban_markdown::KanbanList> kanban_list) final {
@@ -67,10 +69,12 @@ namespace server::commands
 			for (auto& kanban_label : kanban_task->labels) {
 				kanban_label->tasks.erase(std::remove_if(kanban_label->tasks.begin(), kanban_label->tasks.end(), [&kanban_task](const std::shared_ptr<kanban_markdown::KanbanTask>& x)
 					{ return *x == *kanban_task; }), kanban_label->tasks.end());
+				kanban_label->render_cache.invalidate();
 			}
 			auto& task_name_tracker = this->kanban_board->task_name_tracker_map[kanban_task->name];
 			task_name_tracker.removeHash(kanban_task->counter);
 			kanban_list->tasks.erase(kanban_task_iterator);
+			this->change.task.reset();
 		}
 
 		void editTaskName(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task) final {
@@ -97,6 +101,8 @@ namespace server::commands
 			kanban_label->tasks.erase(std::remove_if(kanban_label->tasks.begin(), kanban_label->tasks.end(), [&kanban_task](const std::shared_ptr<kanban_markdown::KanbanTask>& x)
 				{ return *x == *kanban_task; }), kanban_label->tasks.end());
 			kanban_task->labels.erase(kanban_label_iterator);
+			kanban_label->render_cache.invalidate();
+			kanban_task->render_cache.invalidate();
 		}
 
 		void editTaskLabelName(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::shared_ptr<kanban_markdown::KanbanLabel> kanban_label) final {
@@ -108,6 +114,7 @@ namespace server::commands
 
 		void visitTaskAttachment(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::vector<std::shared_ptr<kanban_markdown::KanbanAttachment>>::iterator kanban_attachment_iterator) final {
 			kanban_task->attachments.erase(kanban_attachment_iterator);
+			kanban_task->render_cache.invalidate();
 		}
 
 		void editTaskAttachmentName(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::shared_ptr<kanban_markdown::KanbanAttachment> kanban_attachment) final {
@@ -119,6 +126,7 @@ namespace server::commands
 
 		void visitTaskChecklist(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::vector<std::shared_ptr<kanban_markdown::KanbanChecklistItem>>::iterator kanban_checklist_item_iterator) final {
 			kanban_task->checklist.erase(kanban_checklist_item_iterator);
+			kanban_task->render_cache.invalidate();
 		}
 
 		void editTaskChecklistName(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::shared_ptr<kanban_markdown::KanbanChecklistItem> kanban_checklist_item) final {
@@ -133,8 +141,10 @@ namespace server::commands
 			for (auto& kanban_task : kanban_label->tasks) {
 				kanban_task->labels.erase(std::remove_if(kanban_task->labels.begin(), kanban_task->labels.end(), [&kanban_label](const std::shared_ptr<kanban_markdown::KanbanLabel>& x)
 					{ return *x == *kanban_label; }), kanban_task->labels.end());
+				kanban_task->render_cache.invalidate();
 			}
 			this->kanban_board->labels.erase(kanban_label_iterator);
+			this->change.label.reset();
 		}
 
 		void editLabelName(std::shared_ptr<kanban_markdown::KanbanLabel> kanban_label) final {
@@ -146,7 +156,8 @@ namespace server::commands
 		}
 	};
 
-	void command_delete(KanbanTuple& kanban_tuple, yyjson_val* command)
+	// The deleted node is left out of the change, the nodes it was in are kept
+	Change command_delete(KanbanTuple& kanban_tuple, yyjson_val* command)
 	{
 		yyjson_val* path = yyjson_obj_get(command, "path");
 		if (path == NULL)
@@ -156,5 +167,6 @@ namespace server::commands
 		std::string path_str = yyjson_get_string_object(path);
 		DeleteCommandVisitor visitor(&kanban_tuple.kanban_board, path_str, (void*)nullptr);
 		visitor.run();
+		return visitor.changed();
 	}
 }
\ No newline at end of file
@@ -101,6 +101,7 @@ namespace server::commands
 
 				std::shared_ptr<kanban_markdown::KanbanTask> task = kanban_list->tasks[old_index];
 				task->checked = parent_list->checked;
+				task->render_cache.invalidate();
 				if (move_value->index < 0 || move_value->index >= parent_list->tasks.size())
 				{
 					parent_list->tasks.push_back(task);
@@ -110,6 +111,7 @@ namespace server::commands
 					parent_list->tasks.insert(parent_list->tasks.begin() + move_value->index, task);
 				}
 				kanban_list->tasks.erase(kanban_list->tasks.begin() + old_index);
+				this->change.list = parent_list;
 			}
 		}
 
@@ -179,7 +181,7 @@ namespace server::commands
 		}
 	};
 
-	void command_move(KanbanTuple& kanban_tuple, yyjson_val* command)
+	Change command_move(KanbanTuple& kanban_tuple, yyjson_val* command)
 	{
 		yyjson_val* path = yyjson_obj_get(command, "path");
 		if (path == NULL)
@@ -215,5 +217,6 @@ namespace server::commands
 
 		MoveCommandVisitor visitor(&kanban_tuple.kanban_board, path_str, &move_value);
 		visitor.run();
+		return visitor.changed();
 	}
 }
\ No newline at end of file
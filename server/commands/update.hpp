@@ -50,9 +50,11 @@ namespace server::commands
 			re2::RE2::GlobalReplace(&new_list_name, constants::vertical_whitespace_regex_pattern, "");
 			kanban_list->name = new_list_name;
 			kanban_list->counter = kanban_markdown::utils::kanban_get_counter_with_name(new_list_name, this->kanban_board->list_name_tracker_map);
+			kanban_list->render_cache.invalidate();
 		}
 		void editListChecked(std::shared_ptr<kanban_markdown::KanbanList> kanban_list) final {
 			kanban_list->checked = yyjson_get_bool((yyjson_val*)userdata);
+			kanban_list->render_cache.invalidate();
 		}
 		void editListTasks(std::shared_ptr<kanban_markdown::KanbanList> kanban_list) final {
 			throw std::runtime_error("Invalid path: KanbanList.tasks is a object and cannot be modified.");
@@ -69,12 +71,16 @@ namespace server::commands
 			re2::RE2::GlobalReplace(&new_task_name, constants::vertical_whitespace_regex_pattern, "");
 			kanban_task->name = new_task_name;
 			kanban_task->counter = kanban_markdown::utils::kanban_get_counter_with_name(new_task_name, this->kanban_board->task_name_tracker_map);
+			kanban_markdown::utils::invalidate_task(*kanban_task);
+			kanban_task->slug_cache.invalidate();
 		}
 		void editTaskDescription(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task) final {
 			kanban_task->description = split(yyjson_get_string_object((yyjson_val*)userdata), "\n");
+			kanban_task->render_cache.invalidate();
 		}
 		void editTaskChecked(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task) final {
 			kanban_task->checked = yyjson_get_bool((yyjson_val*)userdata);
+			kanban_task->render_cache.invalidate();
 		}
 		void editTaskLabels(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task) final {
 			throw std::runtime_error("Invalid path: KanbanTask.labels is a object and cannot be modified.");
@@ -94,10 +100,13 @@ namespace server::commands
 			std::string name_str = yyjson_get_string_object((yyjson_val*)userdata);
 			re2::RE2::GlobalReplace(&name_str, constants::vertical_whitespace_regex_pattern, "");
 			kanban_label->name = name_str;
+			kanban_markdown::utils::invalidate_label(*kanban_label);
+			kanban_label->slug_cache.invalidate();
 		}
 
 		void editTaskLabelColor(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::shared_ptr<kanban_markdown::KanbanLabel> kanban_label) final {
 			kanban_label->color = yyjson_get_string_object((yyjson_val*)userdata);
+			kanban_label->render_cache.invalidate();
 		}
 
 		void visitTaskAttachment(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::vector<std::shared_ptr<kanban_markdown::KanbanAttachment>>::iterator kanban_attachment_iterator) final {
@@ -108,9 +117,11 @@ namespace server::commands
 			std::string name_str = yyjson_get_string_object((yyjson_val*)userdata);
 			re2::RE2::GlobalReplace(&name_str, constants::vertical_whitespace_regex_pattern, "");
 			kanban_attachment->name = name_str;
+			kanban_task->render_cache.invalidate();
 		}
 		void editTaskAttachmentUrl(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::shared_ptr<kanban_markdown::KanbanAttachment> kanban_attachment) final {
 			kanban_attachment->url = yyjson_get_string_object((yyjson_val*)userdata);
+			kanban_task->render_cache.invalidate();
 		}
 
 		void visitTaskChecklist(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::vector<std::shared_ptr<kanban_markdown::KanbanChecklistItem>>::iterator kanban_checklist_item_iterator) final {
@@ -121,9 +132,11 @@ namespace server::commands
 			std::string name_str = yyjson_get_string_object((yyjson_val*)userdata);
 			re2::RE2::GlobalReplace(&name_str, constants::vertical_whitespace_regex_pattern, "");
 			kanban_checklist_item->name = name_str;
+			kanban_task->render_cache.invalidate();
 		}
 		void editTaskChecklistChecked(std::shared_ptr<kanban_markdown::KanbanList> kanban_list, std::shared_ptr<kanban_markdown::KanbanTask> kanban_task, std::shared_ptr<kanban_markdown::KanbanChecklistItem> kanban_checklist_item) final {
 			kanban_checklist_item->checked = yyjson_get_bool((yyjson_val*)userdata);
+			kanban_task->render_cache.invalidate();
 		}
 
 		void visitLabel(std::vector<std::shared_ptr<kanban_markdown::KanbanLabel>>::iterator kanban_label_iterator) final {
@@ -134,14 +147,17 @@ namespace server::commands
 			std::string name_str = yyjson_get_string_object((yyjson_val*)userdata);
 			re2::RE2::GlobalReplace(&name_str, constants::vertical_whitespace_regex_pattern, "");
 			kanban_label->name = name_str;
+			kanban_markdown::utils::invalidate_label(*kanban_label);
+			kanban_label->slug_cache.invalidate();
 		}
 
 		void editLabelColor(std::shared_ptr<kanban_markdown::KanbanLabel> kanban_label) final {
 			kanban_label->color = yyjson_get_string_object((yyjson_val*)userdata);
+			kanban_label->render_cache.invalidate();
 		}
 	};
 
-	void command_update(KanbanTuple& kanban_tuple, yyjson_val* command)
+	Change command_update(KanbanTuple& kanban_tuple, yyjson_val* command)
 	{
 		yyjson_val* path = yyjson_obj_get(command, "path");
 		if (path == NULL)
@@ -157,5 +173,6 @@ namespace server::commands
 
 		UpdateCommandVisitor visitor(&kanban_tuple.kanban_board, path_str, (void*)value);
 		visitor.run();
+		return visitor.changed();
 	}
 }
\ No newline at end of file
@@ -1,7 +1,46 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+
 #include <re2/re2.h>
 
 namespace server::constants {
 	static const re2::RE2 vertical_whitespace_regex_pattern("\\v");
-}
\ No newline at end of file
+
+	// How long an automatic save waits for more changes before writing
+	static constexpr std::chrono::milliseconds save_debounce(500);
+
+	// How long a watched file must go unchanged before it is read again
+	static constexpr std::chrono::milliseconds watch_debounce(100);
+
+	// Hashes of the files read or written for a board that are still recognised as this server's own
+	static constexpr std::size_t known_hashes = 8;
+
+	// Requests read ahead of the one executing, and response chunks waiting to be written
+	static constexpr std::size_t pipeline_queue_size = 64;
+
+	// Requests queued or running at once before reading more waits for one to complete
+	static constexpr std::size_t max_in_flight = 64;
+
+	// Largest JSON and payload of a framed request together, a larger frame being refused before any of it is read
+	static constexpr std::size_t max_frame_size = 256 * 1024 * 1024;
+
+	// Buffers kept per client to parse its requests in, each as large as the largest request it held
+	static constexpr std::size_t pooled_request_buffers = 4;
+
+	// Threads running requests for different boards side by side, 0 for one per core
+	static constexpr unsigned int worker_threads = 0;
+
+	// Threads rendering the lists of one board's markdown, on the library's shared pool, 0 for one per core.
+	// Kept at 1 since the workers already keep the cores busy with different boards; raise it for few, large boards.
+	static constexpr unsigned int render_threads = 1;
+
+	// How much memory the open boards may use before the least recently used ones are evicted
+	static constexpr std::size_t session_memory_budget = 512 * 1024 * 1024;
+
+	// Markdown smaller than this is sent without compression
+	static constexpr std::size_t compression_threshold = 1024;
+
+	static constexpr int zstd_level = 3;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <tobiaslocker_base64/base64.hpp>
+
+#include <gzip/compress.hpp>
+
+#include <kanban_markdown/trace.hpp>
+
+// Defined by the build when the zstd package was found
+#ifdef KANBAN_MARKDOWN_SERVER_ZSTD
+#include <zstd.h>
+#endif
+
+#include "constants.hpp"
+#include "framing.hpp"
+
+// Encodings of the markdown sent back by get markdown, chosen by the request's "encoding" field.
+// The encoded bytes are base64 encoded to go in the JSON, or sent as they are in the payload of a framed response.
+namespace server::encoding
+{
+	enum class Encoding
+	{
+		none,
+		gzip_fast,
+		gzip,
+		zstd,
+	};
+
+	static inline Encoding parse(const std::string& name)
+	{
+		if (name == "none")
+		{
+			return Encoding::none;
+		}
+		if (name == "gzip-fast")
+		{
+			return Encoding::gzip_fast;
+		}
+		if (name == "gzip")
+		{
+			return Encoding::gzip;
+		}
+		if (name == "zstd")
+		{
+#ifdef KANBAN_MARKDOWN_SERVER_ZSTD
+			return Encoding::zstd;
+#else
+			throw std::runtime_error("Error: This server was built without zstd.");
+#endif
+		}
+		throw std::runtime_error(fmt::format(R"(Error: Unknown encoding "{}".)", name));
+	}
+
+	static inline const char* name(Encoding encoding)
+	{
+		switch (encoding)
+		{
+		case Encoding::gzip_fast:
+			return "gzip-fast";
+		case Encoding::gzip:
+			return "gzip";
+		case Encoding::zstd:
+			return "zstd";
+		default:
+			return "none";
+		}
+	}
+
+	// Small payloads are sent as they are, compressing them saving next to nothing.
+	static inline Encoding effective(Encoding encoding, std::size_t size)
+	{
+		return size < constants::compression_threshold ? Encoding::none : encoding;
+	}
+
+	static inline std::string compress(Encoding encoding, const std::string& data)
+	{
+		KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL("server", "compress", name(encoding));
+		switch (encoding)
+		{
+		case Encoding::gzip_fast:
+			return gzip::compress(data.data(), data.size(), Z_BEST_SPEED);
+		case Encoding::gzip:
+			return gzip::compress(data.data(), data.size(), Z_BEST_COMPRESSION);
+#ifdef KANBAN_MARKDOWN_SERVER_ZSTD
+		case Encoding::zstd:
+		{
+			std::string compressed(ZSTD_compressBound(data.size()), '\0');
+			const std::size_t size = ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), constants::zstd_level);
+			if (ZSTD_isError(size))
+			{
+				throw std::runtime_error(fmt::format("Error: Unable to compress with zstd: {}", ZSTD_getErrorName(size)));
+			}
+			compressed.resize(size);
+			return compressed;
+		}
+#endif
+		default:
+			return data;
+		}
+	}
+
+	// The last encoded markdown for each encoding, with the board version it was encoded at.
+	class Cache
+	{
+	public:
+		// Encodes the markdown the board has at version, unless it was already encoded at that version.
+		// render is only called when it was not.
+		template <typename Render>
+		const std::string& get(unsigned int version, Encoding encoding, Render render)
+		{
+			Entry& entry = this->entries[static_cast<std::size_t>(encoding)];
+			if (!entry.valid || entry.version != version)
+			{
+				const std::string markdown = render();
+				entry.encoding = effective(encoding, markdown.size());
+				entry.data = entry.encoding == Encoding::none ? markdown : compress(entry.encoding, markdown);
+				// Raw bytes in a frame, and plain markdown being valid in JSON
+				if (entry.encoding != Encoding::none && framing::mode() == framing::Mode::lines)
+				{
+					entry.data = base64::to_base64(entry.data);
+				}
+				entry.version = version;
+				entry.valid = true;
+			}
+			return entry.data;
+		}
+
+		// The encoding used by the entry get last returned for encoding, none for a small payload.
+		Encoding used(Encoding encoding) const
+		{
+			return this->entries[static_cast<std::size_t>(encoding)].encoding;
+		}
+
+		std::size_t capacity() const
+		{
+			std::size_t size = 0;
+			for (const Entry& entry : this->entries)
+			{
+				size += entry.data.capacity();
+			}
+			return size;
+		}
+
+	private:
+		struct Entry
+		{
+			bool valid = false;
+			unsigned int version = 0;
+			Encoding encoding = Encoding::none;
+			std::string data;
+		};
+
+		Entry entries[4];
+	};
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "internal.hpp"
+#include "request_buffer.hpp"
+
+namespace server
+{
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(std::size_t threads)
+		{
+			for (std::size_t i = 0; i < threads; i++)
+			{
+				this->threads.emplace_back(&ThreadPool::run, this);
+			}
+		}
+
+		// Runs the tasks already posted before returning.
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->stopping = true;
+			}
+			this->condition.notify_all();
+			for (auto& thread : this->threads)
+			{
+				thread.join();
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void post(std::function<void()> task)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->tasks.push_back(std::move(task));
+			}
+			this->condition.notify_one();
+		}
+
+	private:
+		void run()
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			while (true)
+			{
+				this->condition.wait(lock, [this]() { return this->stopping || !this->tasks.empty(); });
+				if (this->tasks.empty())
+				{
+					return;
+				}
+				std::function<void()> task = std::move(this->tasks.front());
+				this->tasks.pop_front();
+				lock.unlock();
+				task();
+				lock.lock();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::deque<std::function<void()>> tasks;
+		bool stopping = false;
+		std::vector<std::thread> threads;
+	};
+
+	// Runs the tasks posted for one board on the pool in the order they were posted.
+	// A task is either a read, which may run alongside the other reads next to it, or a write, which runs alone,
+	// so the strand is also the read/write lock of its board.
+	class BoardStrand
+	{
+	public:
+		explicit BoardStrand(ThreadPool& pool) : pool(pool) {}
+
+		BoardStrand(const BoardStrand&) = delete;
+		BoardStrand& operator=(const BoardStrand&) = delete;
+
+		void post(std::function<void()> task, bool read)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->pending.push_back(Task{ std::move(task), read });
+			this->schedule();
+		}
+
+	private:
+		struct Task
+		{
+			std::function<void()> run;
+			bool read;
+		};
+
+		// Called with the mutex held
+		void schedule()
+		{
+			while (!this->pending.empty() && !this->running_write)
+			{
+				Task& next = this->pending.front();
+				if (!next.read && this->running_reads > 0)
+				{
+					return;
+				}
+				if (next.read)
+				{
+					this->running_reads++;
+				}
+				else
+				{
+					this->running_write = true;
+				}
+				this->pool.post([this, task = std::move(next)]() {
+					task.run();
+					std::lock_guard<std::mutex> lock(this->mutex);
+					if (task.read)
+					{
+						this->running_reads--;
+					}
+					else
+					{
+						this->running_write = false;
+					}
+					this->schedule();
+				});
+				this->pending.pop_front();
+			}
+		}
+
+		ThreadPool& pool;
+		std::mutex mutex;
+		std::deque<Task> pending;
+		std::size_t running_reads = 0;
+		bool running_write = false;
+	};
+
+	// Passes on the responses to a client's requests as each one completes, which may not be the order of the requests,
+	// clients matching responses to requests by their id.
+	// One response at a time is passed on as it is written, the others are held until it is done so responses never interleave.
+	class ClientOutput
+	{
+	public:
+		// on_finish is called once each response is done, after in_flight counts it out
+		explicit ClientOutput(std::function<void(std::string)> sink, std::function<void()> on_finish = nullptr) : sink(std::move(sink)), on_finish(std::move(on_finish)) {}
+
+		// Identifies the response to the next request, or to a notification sent without one
+		std::uint64_t sequence()
+		{
+			return this->submitted.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void write(std::uint64_t sequence, std::string chunk)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (!this->streaming.has_value())
+			{
+				this->streaming = sequence;
+			}
+			if (sequence == this->streaming)
+			{
+				this->sink(std::move(chunk));
+				return;
+			}
+			this->held[sequence].chunks.push_back(std::move(chunk));
+		}
+
+		void finish(std::uint64_t sequence)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				if (sequence == this->streaming)
+				{
+					this->streaming.reset();
+					this->drain();
+				}
+				else
+				{
+					auto it = this->held.find(sequence);
+					if (it != this->held.end())
+					{
+						it->second.finished = true;
+					}
+				}
+			}
+			this->finished.fetch_add(1, std::memory_order_release);
+			if (this->on_finish)
+			{
+				this->on_finish();
+			}
+		}
+
+		// Requests given a sequence whose response is not done yet
+		std::uint64_t in_flight() const
+		{
+			return this->submitted.load(std::memory_order_relaxed) - this->finished.load(std::memory_order_acquire);
+		}
+
+		// How many of the client's requests may be in flight before no more are read from it, set by the client itself
+		std::size_t max_in_flight() const
+		{
+			return this->limit.load(std::memory_order_relaxed);
+		}
+
+		void set_max_in_flight(std::size_t max_in_flight)
+		{
+			this->limit.store(max_in_flight, std::memory_order_relaxed);
+		}
+
+	private:
+		struct Held
+		{
+			std::vector<std::string> chunks;
+			bool finished = false;
+		};
+
+		// Called with the mutex held once no response is being passed on:
+		// passes on the responses completed meanwhile, then lets one still being written carry on where it is.
+		void drain()
+		{
+			for (auto it = this->held.begin(); it != this->held.end(); )
+			{
+				if (!it->second.finished)
+				{
+					++it;
+					continue;
+				}
+				for (std::string& chunk : it->second.chunks)
+				{
+					this->sink(std::move(chunk));
+				}
+				it = this->held.erase(it);
+			}
+			if (!this->held.empty())
+			{
+				auto it = this->held.begin();
+				for (std::string& chunk : it->second.chunks)
+				{
+					this->sink(std::move(chunk));
+				}
+				this->streaming = it->first;
+				this->held.erase(it);
+			}
+		}
+
+		std::mutex mutex;
+		std::function<void(std::string)> sink;
+		std::function<void()> on_finish;
+		std::atomic<std::uint64_t> submitted = 0;
+		std::atomic<std::uint64_t> finished = 0;
+		std::atomic<std::size_t> limit = constants::max_in_flight;
+		std::optional<std::uint64_t> streaming;
+		std::map<std::uint64_t, Held> held;
+	};
+
+	// Where the responses to a client go, the board its requests are for when they name none, and the buffers they are parsed in.
+	struct Client
+	{
+		std::shared_ptr<ClientOutput> output;
+		std::string last_key;
+		std::shared_ptr<RequestBufferPool> buffers = std::make_shared<RequestBufferPool>();
+	};
+
+	// Runs requests on a pool, through the strand of the board they are for, whichever client sent them.
+	// Requests not for a board run on the thread submitting them.
+	// Requests are submitted by the thread reading them, and the reloads of changed files by the file watcher's.
+	class Executor
+	{
+	public:
+		explicit Executor(std::size_t threads) : pool(threads) {}
+
+		// Waits for every submitted request
+		~Executor()
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->condition.wait(lock, [this]() { return this->running == 0; });
+		}
+
+		// Waits until fewer than limit requests are queued or running, holding back the requests after them.
+		void wait_below(std::size_t limit)
+		{
+			KANBAN_MARKDOWN_TRACE_SCOPE("server", "wait");
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->condition.wait(lock, [this, limit]() { return this->running < std::max<std::size_t>(limit, 1); });
+		}
+
+		// Waits until fewer than the client's max_in_flight of its requests are in flight, holding back its requests after them.
+		void wait_below(const ClientOutput& output)
+		{
+			KANBAN_MARKDOWN_TRACE_SCOPE("server", "wait");
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->condition.wait(lock, [&output]() { return output.in_flight() < std::max<std::size_t>(output.max_in_flight(), 1); });
+		}
+
+		// run is called with the response output of the calling thread sent to output.
+		// An empty key runs it inline, for requests that use no board.
+		void submit(const std::shared_ptr<ClientOutput>& output, const std::string& key, bool read, std::function<void()> run)
+		{
+			const std::uint64_t sequence = output->sequence();
+			auto task = [this, output, sequence, run = std::move(run)]() {
+				ResponseOutput& response = response_output();
+				response.sink = [&output, sequence](std::string chunk) { output->write(sequence, std::move(chunk)); };
+				run();
+				response.finish();
+				response.sink = nullptr;
+				output->finish(sequence);
+
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->running--;
+				this->condition.notify_all();
+			};
+			BoardStrand* strand = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->running++;
+				if (!key.empty())
+				{
+					std::unique_ptr<BoardStrand>& board_strand = this->strands[key];
+					if (board_strand == nullptr)
+					{
+						board_strand = std::make_unique<BoardStrand>(this->pool);
+					}
+					strand = board_strand.get();
+				}
+			}
+			if (strand == nullptr)
+			{
+				task();
+				return;
+			}
+			strand->post(std::move(task), read);
+		}
+
+	private:
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::size_t running = 0;
+		// Never erased, so a strand can be posted to outside the mutex
+		std::unordered_map<std::string, std::unique_ptr<BoardStrand>> strands;
+		// Last, so its threads are joined before the strands they use are destroyed
+		ThreadPool pool;
+	};
+}
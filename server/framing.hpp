@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "constants.hpp"
+
+// Framing of requests and responses on stdin and stdout.
+// By default every message is one line of JSON. Started with --framed, every message is instead:
+//   u32 JSON length, u32 payload length (little endian), the JSON, then the payload
+// The payload carries raw bytes next to the JSON: the board content of a parseFileWithContent request,
+// or the markdown of a get markdown response, neither being gzip compressed and base64 encoded then.
+namespace server::framing
+{
+	enum class Mode
+	{
+		lines,
+		length_prefixed,
+	};
+
+	// Set once at startup, before any thread reads it.
+	static inline Mode& mode()
+	{
+		static Mode mode = Mode::lines;
+		return mode;
+	}
+
+	static inline void append_u32(std::string& out, std::uint32_t value)
+	{
+		const char bytes[] = {
+			static_cast<char>(value & 0xFF),
+			static_cast<char>((value >> 8) & 0xFF),
+			static_cast<char>((value >> 16) & 0xFF),
+			static_cast<char>((value >> 24) & 0xFF),
+		};
+		out.append(bytes, sizeof(bytes));
+	}
+
+	static inline std::uint32_t get_u32(const unsigned char* bytes)
+	{
+		return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+	}
+
+	static inline std::string header(std::size_t json_size, std::size_t payload_size)
+	{
+		std::string out;
+		append_u32(out, static_cast<std::uint32_t>(json_size));
+		append_u32(out, static_cast<std::uint32_t>(payload_size));
+		return out;
+	}
+
+	// The sizes at the front of every frame, the JSON and payload being read by the caller straight to where they go
+	struct Header
+	{
+		std::size_t json_size;
+		std::size_t payload_size;
+	};
+
+	static constexpr std::size_t header_size = 8;
+
+	static inline Header get_header(const unsigned char* bytes)
+	{
+		return Header{ get_u32(bytes), get_u32(bytes + 4) };
+	}
+
+	static inline bool too_large(const Header& header)
+	{
+		return header.json_size + header.payload_size > constants::max_frame_size;
+	}
+
+	// False at the end of the input.
+	static inline bool read_header(std::FILE* file, Header& header)
+	{
+		unsigned char bytes[header_size];
+		if (std::fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes))
+		{
+			return false;
+		}
+		header = get_header(bytes);
+		return true;
+	}
+
+	// For input arriving in pieces, false while the header has not all arrived.
+	static inline bool read_header(std::string_view input, Header& header)
+	{
+		if (input.size() < header_size)
+		{
+			return false;
+		}
+		header = get_header(reinterpret_cast<const unsigned char*>(input.data()));
+		return true;
+	}
+}
@@ -1,13 +1,26 @@
 #pragma once
 
 #include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
 #include <string_view>
 #include <iomanip>
 
 #include <yyjson.h>
 
 #include <kanban_markdown/kanban_board.hpp>
+#include <kanban_markdown/trace.hpp>
 #include <kanban_markdown/utils.hpp>
+#include <kanban_markdown/writer/markdown.hpp>
+
+#include "constants.hpp"
+#include "encoding.hpp"
+#include "framing.hpp"
+#include "json_patch.hpp"
+#include "stats.hpp"
 
 namespace server
 {
@@ -43,6 +56,13 @@ namespace server
 		return std::string(val_data, val_size);
 	}
 
+	// Valid as long as the document, for strings only read or passed on
+	static inline std::string_view yyjson_get_string_view(yyjson_val* val)
+	{
+		const char* val_data = yyjson_get_str(val);
+		return val_data != nullptr ? std::string_view(val_data, yyjson_get_len(val)) : std::string_view();
+	}
+
 	static inline std::string urlDecode(std::string text)
 	{
 		std::string escaped;
@@ -71,9 +91,158 @@ namespace server
 		return escaped;
 	}
 
+	// Every response document and its written JSON are allocated from a pool kept for the lifetime of the thread,
+	// so a response does not go back to malloc once the pool has grown to the size of the largest response.
+	static inline yyjson_alc* response_allocator()
+	{
+		static thread_local std::unique_ptr<yyjson_alc, decltype(&yyjson_alc_dyn_free)> allocator(yyjson_alc_dyn_new(), yyjson_alc_dyn_free);
+		return allocator.get();
+	}
+
+	static inline yyjson_mut_doc* new_response_doc()
+	{
+		return yyjson_mut_doc_new(response_allocator());
+	}
+
+	// Where the responses of this thread are written: stdout, or the sink while one is set.
+	// With lines the output is passed on in chunks of about chunk_size bytes as it is written.
+	// With length prefixed frames the length has to be known first, so the response is held until finish.
+	class ResponseOutput
+	{
+	public:
+		static constexpr std::size_t chunk_size = 64 * 1024;
+
+		void write(const char* data, std::size_t size)
+		{
+			this->written += size;
+			this->buffer.append(data, size);
+			if (this->buffer.size() >= chunk_size && framing::mode() == framing::Mode::lines)
+			{
+				this->flush();
+			}
+		}
+
+		// Ends the response to the current request.
+		void finish()
+		{
+			if (framing::mode() == framing::Mode::length_prefixed)
+			{
+				this->emit(framing::header(this->buffer.size(), this->payload.size()));
+				this->emit(std::move(this->buffer));
+				this->emit(std::move(this->payload));
+				this->buffer = std::string();
+				this->payload = std::string();
+				return;
+			}
+			this->payload.clear();
+			this->flush();
+		}
+
+		std::function<void(std::string)> sink;
+		// Raw bytes sent after the JSON of a framed response, ignored with lines
+		std::string payload;
+		// Bytes written on this thread so far, not counting payloads
+		std::uint64_t written = 0;
+
+	private:
+		void flush()
+		{
+			if (!this->buffer.empty())
+			{
+				this->emit(std::move(this->buffer));
+				this->buffer = std::string();
+			}
+		}
+
+		void emit(std::string data)
+		{
+			if (data.empty())
+			{
+				return;
+			}
+			if (this->sink)
+			{
+				this->sink(std::move(data));
+			}
+			else
+			{
+				fwrite(data.data(), 1, data.size(), stdout);
+				fflush(stdout);
+			}
+		}
+
+		std::string buffer;
+	};
+
+	static inline ResponseOutput& response_output()
+	{
+		static thread_local ResponseOutput output;
+		return output;
+	}
+
+	static inline void write_response(const char* data, std::size_t size)
+	{
+		response_output().write(data, size);
+	}
+
+	// Writes the response and frees its document.
+	static inline void send_response(yyjson_mut_doc* doc)
+	{
+		KANBAN_MARKDOWN_TRACE_SCOPE("server", "serialize");
+		const stats::Timer timer;
+		yyjson_alc* allocator = response_allocator();
+		std::size_t length = 0;
+		char* json = yyjson_mut_write_opts(doc, 0, allocator, &length, nullptr);
+		if (json != nullptr)
+		{
+			write_response(json, length);
+			write_response("\n", 1);
+			allocator->free(allocator->ctx, json);
+		}
+		yyjson_mut_doc_free(doc);
+		stats::local().serialize_microseconds += timer.microseconds();
+	}
+
+	// A whole message sent outside of any response, such as a notification, in a frame of its own when requests are framed.
+	static inline std::string format_message(yyjson_mut_doc* doc)
+	{
+		yyjson_alc* allocator = response_allocator();
+		std::size_t length = 0;
+		char* json = yyjson_mut_write_opts(doc, 0, allocator, &length, nullptr);
+		std::string message;
+		if (json != nullptr)
+		{
+			if (framing::mode() == framing::Mode::length_prefixed)
+			{
+				message = framing::header(length + 1, 0);
+			}
+			message.append(json, length);
+			message += '\n';
+			allocator->free(allocator->ctx, json);
+		}
+		yyjson_mut_doc_free(doc);
+		return message;
+	}
+
 	struct KanbanTuple
 	{
 		std::string file_path;
 		kanban_markdown::KanbanBoard kanban_board;
+		kanban_markdown::writer::markdown::Cache markdown_cache;
+		// The markdown as last sent by get markdown, in each encoding
+		encoding::Cache markdown_encoded;
+		json_patch::History json_history;
+		// Hashes of the whole files last read or written, newest last,
+		// so a watched file changing to one of them is known to be this server's own save
+		std::deque<std::string> file_hashes;
 	};
+
+	static inline void remember_hash(KanbanTuple& kanban_tuple, std::string hash)
+	{
+		kanban_tuple.file_hashes.push_back(std::move(hash));
+		while (kanban_tuple.file_hashes.size() > constants::known_hashes)
+		{
+			kanban_tuple.file_hashes.pop_front();
+		}
+	}
 }
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <yyjson.h>
+
+namespace server::json_patch
+{
+	// How many previous versions of the board are kept to compute patches against
+	static constexpr std::size_t history_size = 8;
+
+	struct Snapshot
+	{
+		unsigned int version;
+		std::shared_ptr<yyjson_doc> doc;
+	};
+
+	// Immutable copies of the JSON sent for the last versions of the board, newest last.
+	struct History
+	{
+		std::deque<Snapshot> snapshots;
+
+		std::shared_ptr<yyjson_doc> find(unsigned int version) const
+		{
+			for (auto it = this->snapshots.rbegin(); it != this->snapshots.rend(); ++it)
+			{
+				if (it->version == version)
+				{
+					return it->doc;
+				}
+			}
+			return nullptr;
+		}
+
+		// Stores a copy of the root of doc as the JSON of the given version.
+		std::shared_ptr<yyjson_doc> push(unsigned int version, yyjson_mut_doc* doc)
+		{
+			if (!this->snapshots.empty() && this->snapshots.back().version == version)
+			{
+				this->snapshots.pop_back();
+			}
+			yyjson_doc* snapshot = yyjson_mut_doc_imut_copy(doc, nullptr);
+			if (snapshot == nullptr)
+			{
+				throw std::runtime_error("Error: Unable to copy the JSON of the board.");
+			}
+			this->snapshots.push_back(Snapshot{ version, std::shared_ptr<yyjson_doc>(snapshot, yyjson_doc_free) });
+			while (this->snapshots.size() > history_size)
+			{
+				this->snapshots.pop_front();
+			}
+			return this->snapshots.back().doc;
+		}
+	};
+
+	// Writes the RFC 6902 operations turning one JSON value into another.
+	// Arrays are compared after removing their common prefix and suffix, so moving, adding or removing a task only touches that task.
+	class Diff
+	{
+	public:
+		Diff(yyjson_mut_doc* doc, yyjson_mut_val* patch) : doc(doc), patch(patch) {}
+
+		void value(yyjson_val* old_val, yyjson_val* new_val, const std::string& path)
+		{
+			if (yyjson_equals(old_val, new_val))
+			{
+				return;
+			}
+			if (yyjson_is_obj(old_val) && yyjson_is_obj(new_val))
+			{
+				this->object(old_val, new_val, path);
+			}
+			else if (yyjson_is_arr(old_val) && yyjson_is_arr(new_val))
+			{
+				this->array(old_val, new_val, path);
+			}
+			else
+			{
+				this->add_operation("replace", path, new_val);
+			}
+		}
+
+	private:
+		yyjson_mut_doc* doc;
+		yyjson_mut_val* patch;
+
+		static std::string append_token(const std::string& path, std::string_view token)
+		{
+			std::string result;
+			result.reserve(path.size() + token.size() + 1);
+			result += path;
+			result += '/';
+			for (char c : token)
+			{
+				switch (c)
+				{
+				case '~':
+					result += "~0";
+					break;
+				case '/':
+					result += "~1";
+					break;
+				default:
+					result += c;
+				}
+			}
+			return result;
+		}
+
+		static std::string append_index(const std::string& path, std::size_t index)
+		{
+			return fmt::format("{}/{}", path, index);
+		}
+
+		static std::vector<yyjson_val*> elements(yyjson_val* arr)
+		{
+			std::vector<yyjson_val*> result;
+			result.reserve(yyjson_arr_size(arr));
+			yyjson_val* element;
+			size_t idx, max;
+			yyjson_arr_foreach(arr, idx, max, element) {
+				result.push_back(element);
+			}
+			return result;
+		}
+
+		void add_operation(const char* op, const std::string& path, yyjson_val* value = nullptr, const std::string* from = nullptr)
+		{
+			yyjson_mut_val* operation = yyjson_mut_obj(this->doc);
+			yyjson_mut_obj_add_str(this->doc, operation, "op", op);
+			if (from != nullptr)
+			{
+				yyjson_mut_obj_add_strncpy(this->doc, operation, "from", from->c_str(), from->size());
+			}
+			yyjson_mut_obj_add_strncpy(this->doc, operation, "path", path.c_str(), path.size());
+			if (value != nullptr)
+			{
+				yyjson_mut_obj_add_val(this->doc, operation, "value", yyjson_val_mut_copy(this->doc, value));
+			}
+			yyjson_mut_arr_append(this->patch, operation);
+		}
+
+		void object(yyjson_val* old_obj, yyjson_val* new_obj, const std::string& path)
+		{
+			std::unordered_map<std::string_view, yyjson_val*> new_members;
+			new_members.reserve(yyjson_obj_size(new_obj));
+			yyjson_val* key;
+			yyjson_val* val;
+			size_t idx, max;
+			yyjson_obj_foreach(new_obj, idx, max, key, val) {
+				new_members.emplace(std::string_view(yyjson_get_str(key), yyjson_get_len(key)), val);
+			}
+
+			yyjson_obj_foreach(old_obj, idx, max, key, val) {
+				std::string_view name(yyjson_get_str(key), yyjson_get_len(key));
+				auto it = new_members.find(name);
+				if (it == new_members.end())
+				{
+					this->add_operation("remove", append_token(path, name));
+					continue;
+				}
+				this->value(val, it->second, append_token(path, name));
+				new_members.erase(it);
+			}
+
+			// Whatever is left was not in the old object
+			yyjson_obj_foreach(new_obj, idx, max, key, val) {
+				std::string_view name(yyjson_get_str(key), yyjson_get_len(key));
+				if (new_members.find(name) != new_members.end())
+				{
+					this->add_operation("add", append_token(path, name), val);
+				}
+			}
+		}
+
+		void array(yyjson_val* old_arr, yyjson_val* new_arr, const std::string& path)
+		{
+			const std::vector<yyjson_val*> old_elements = elements(old_arr);
+			const std::vector<yyjson_val*> new_elements = elements(new_arr);
+
+			std::size_t begin = 0;
+			while (begin < old_elements.size() && begin < new_elements.size() && yyjson_equals(old_elements[begin], new_elements[begin]))
+			{
+				begin++;
+			}
+			std::size_t old_end = old_elements.size();
+			std::size_t new_end = new_elements.size();
+			while (old_end > begin && new_end > begin && yyjson_equals(old_elements[old_end - 1], new_elements[new_end - 1]))
+			{
+				old_end--;
+				new_end--;
+			}
+
+			// An element moved inside the array rotates what is left by one
+			const std::size_t length = old_end - begin;
+			if (length >= 2 && length == new_end - begin)
+			{
+				auto equal_range = [&](std::size_t old_first, std::size_t new_first, std::size_t count) {
+					for (std::size_t i = 0; i < count; i++)
+					{
+						if (!yyjson_equals(old_elements[old_first + i], new_elements[new_first + i]))
+						{
+							return false;
+						}
+					}
+					return true;
+				};
+				if (yyjson_equals(old_elements[begin], new_elements[new_end - 1]) && equal_range(begin + 1, begin, length - 1))
+				{
+					const std::string from = append_index(path, begin);
+					this->add_operation("move", append_index(path, new_end - 1), nullptr, &from);
+					return;
+				}
+				if (yyjson_equals(old_elements[old_end - 1], new_elements[begin]) && equal_range(begin, begin + 1, length - 1))
+				{
+					const std::string from = append_index(path, old_end - 1);
+					this->add_operation("move", append_index(path, begin), nullptr, &from);
+					return;
+				}
+			}
+
+			const std::size_t common = std::min(old_end, new_end) - begin;
+			for (std::size_t i = begin; i < begin + common; i++)
+			{
+				this->value(old_elements[i], new_elements[i], append_index(path, i));
+			}
+			for (std::size_t i = begin + common; i < old_end; i++)
+			{
+				this->add_operation("remove", append_index(path, begin + common));
+			}
+			for (std::size_t i = begin + common; i < new_end; i++)
+			{
+				this->add_operation("add", append_index(path, i), new_elements[i]);
+			}
+		}
+	};
+}
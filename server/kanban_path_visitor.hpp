@@ -11,6 +11,14 @@
 
 namespace server
 {
+	// The nodes a command went through or made, reported back to clients that asked for the changes.
+	struct Change
+	{
+		std::shared_ptr<kanban_markdown::KanbanList> list;
+		std::shared_ptr<kanban_markdown::KanbanTask> task;
+		std::shared_ptr<kanban_markdown::KanbanLabel> label;
+	};
+
 	class KanbanPathVisitor
 	{
 #pragma region Public
@@ -36,6 +44,11 @@ namespace server
 				this->internal_visitBoard();
 			}
 		}
+
+		const Change& changed() const
+		{
+			return this->change;
+		}
 #pragma endregion
 
 #pragma region Use These
@@ -43,6 +56,8 @@ namespace server
 		kanban_markdown::KanbanBoard* kanban_board;
 		std::vector<std::string> path_split;
 		void* userdata;
+		// Filled with the nodes on the path, visitors set the nodes they create
+		Change change;
 #pragma endregion
 
 #pragma region Override These
@@ -220,6 +235,7 @@ namespace server
 			{
 				throw std::runtime_error(fmt::format(R"(Invalid path: There are no keys inside KanbanBoard.list named "{}" [{}])", board_item_index_name, board_index_counter));
 			}
+			this->change.list = *it;
 			if (this->path_split.size() == 1)
 			{
 				this->visitList(it);
@@ -278,6 +294,7 @@ namespace server
 			{
 				throw std::runtime_error(fmt::format(R"(Invalid path: There are no keys inside KanbanList.tasks named "{}")", task_index_name));
 			}
+			this->change.task = *it;
 			if (this->path_split.size() == 2)
 			{
 				this->visitTask(kanban_list, it);
@@ -345,6 +362,7 @@ namespace server
 			{
 				throw std::runtime_error(fmt::format(R"(Invalid path: There are no keys inside KanbanTask.labels named "{}")", task_item_index_name));
 			}
+			this->change.label = *it;
 			if (this->path_split.size() == 3)
 			{
 				this->visitTaskLabel(kanban_list, kanban_task, it);
@@ -437,6 +455,7 @@ namespace server
 			{
 				throw std::runtime_error(fmt::format(R"(Invalid path: There are no keys inside KanbanBoard.labels named "{}")", board_item_index_name));
 			}
+			this->change.label = *it;
 			if (this->path_split.size() == 1)
 			{
 				this->visitLabel(it);
@@ -1,8 +1,88 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 #include "server.hpp"
 using namespace server;
 
-int main() {
+// Runs until stdin is closed or, with a socket, until SIGINT or SIGTERM
+static int serve(const std::string& socket_path)
+{
 	KanbanServer server{};
+	if (!socket_path.empty())
+	{
+#ifdef __linux__
+		try
+		{
+			server.listen(socket_path);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+		return 0;
+#else
+		std::cerr << "Error: --socket is only supported on Linux.\n";
+		return 1;
+#endif
+	}
 	server.start();
 	return 0;
 }
+
+int main(int argc, char* argv[]) {
+	std::string socket_path;
+	// Where to write Chrome trace events, from KANBAN_MARKDOWN_TRACE_FILE or --trace
+	std::string trace_path;
+	if (const char* trace_env = std::getenv("KANBAN_MARKDOWN_TRACE_FILE"))
+	{
+		trace_path = trace_env;
+	}
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--framed") == 0)
+		{
+			framing::mode() = framing::Mode::length_prefixed;
+		}
+		else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+		{
+			socket_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			trace_path = argv[++i];
+		}
+	}
+#ifdef _WIN32
+	// Frames hold raw bytes, which must not go through newline translation
+	if (framing::mode() == framing::Mode::length_prefixed)
+	{
+		_setmode(_fileno(stdin), _O_BINARY);
+		_setmode(_fileno(stdout), _O_BINARY);
+	}
+#endif
+#ifdef KANBAN_MARKDOWN_TRACE
+	if (!trace_path.empty())
+	{
+		kanban_markdown::trace::start(trace_path);
+	}
+#else
+	if (!trace_path.empty())
+	{
+		std::cerr << "Warning: This server was built without the trace option, no trace is written.\n";
+	}
+#endif
+	// The server is gone by the time the trace is written, so the saves it finishes on the way out are in it
+	const int result = serve(socket_path);
+#ifdef KANBAN_MARKDOWN_TRACE
+	kanban_markdown::trace::stop();
+#endif
+	return result;
+}
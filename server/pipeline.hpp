@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace server
+{
+	// Lets a thread sleep until another one changes something it is polling.
+	// The waiting side sets sleeping before checking its condition a last time under the mutex, and the notifying side checks sleeping
+	// after making its change, so one of them always sees the other and a wake up is never lost.
+	class Waiter
+	{
+	public:
+		template <typename Predicate>
+		void wait(Predicate predicate)
+		{
+			for (int i = 0; i < 64; i++)
+			{
+				if (predicate())
+				{
+					return;
+				}
+				std::this_thread::yield();
+			}
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->sleeping.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			this->condition.wait(lock, predicate);
+			this->sleeping.store(false);
+		}
+
+		void notify()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (this->sleeping.load())
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->condition.notify_one();
+			}
+		}
+
+	private:
+		std::atomic<bool> sleeping = false;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+
+	// Bounded queue between exactly one producing and one consuming thread.
+	// Pushing and popping only touch the two indices, the threads sleep only when the queue is full or empty.
+	template <typename T>
+	class SpscQueue
+	{
+	public:
+		// capacity is rounded up to a power of two
+		explicit SpscQueue(std::size_t capacity)
+		{
+			std::size_t size = 2;
+			while (size < capacity)
+			{
+				size *= 2;
+			}
+			this->slots.resize(size);
+			this->mask = size - 1;
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		void push(T value)
+		{
+			if (!this->push_slot(value))
+			{
+				this->not_full.wait([&]() { return this->push_slot(value); });
+			}
+			this->not_empty.notify();
+		}
+
+		T pop()
+		{
+			T value;
+			if (!this->pop_slot(value))
+			{
+				this->not_empty.wait([&]() { return this->pop_slot(value); });
+			}
+			this->not_full.notify();
+			return value;
+		}
+
+		// Only meaningful on the consuming thread, where it can only be wrong by missing a value just pushed.
+		bool empty() const
+		{
+			return this->head.load(std::memory_order_relaxed) == this->tail.load(std::memory_order_acquire);
+		}
+
+	private:
+		// These do not notify, as they also run as wait predicates under the waiter's mutex
+		bool push_slot(T& value)
+		{
+			const std::size_t tail = this->tail.load(std::memory_order_relaxed);
+			if (tail - this->head.load(std::memory_order_acquire) == this->slots.size())
+			{
+				return false;
+			}
+			this->slots[tail & this->mask] = std::move(value);
+			this->tail.store(tail + 1, std::memory_order_seq_cst);
+			return true;
+		}
+
+		bool pop_slot(T& value)
+		{
+			const std::size_t head = this->head.load(std::memory_order_relaxed);
+			if (head == this->tail.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			value = std::move(this->slots[head & this->mask]);
+			this->head.store(head + 1, std::memory_order_seq_cst);
+			return true;
+		}
+
+		std::vector<T> slots;
+		std::size_t mask;
+		alignas(64) std::atomic<std::size_t> head = 0;
+		alignas(64) std::atomic<std::size_t> tail = 0;
+		Waiter not_empty;
+		Waiter not_full;
+	};
+}
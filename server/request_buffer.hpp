@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <yyjson.h>
+
+#include "constants.hpp"
+
+namespace server
+{
+	// The memory a request is read and parsed in: its JSON, padded for yyjson to parse it in place, its payload,
+	// and the allocator its values come from. Requests are read straight into it, and strings in the document
+	// point into the JSON, so even a large "content" is never copied out of it.
+	struct RequestBuffer
+	{
+		std::string json;
+		std::string payload;
+		std::unique_ptr<yyjson_alc, decltype(&yyjson_alc_dyn_free)> allocator{ yyjson_alc_dyn_new(), yyjson_alc_dyn_free };
+	};
+
+	// The buffers of one client, taken by the thread reading its requests and given back by whichever thread ran them.
+	// A buffer keeps the memory of the largest request it held, so once the pool has grown a request allocates nothing.
+	class RequestBufferPool
+	{
+	public:
+		std::unique_ptr<RequestBuffer> take()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (this->free.empty())
+			{
+				return std::make_unique<RequestBuffer>();
+			}
+			std::unique_ptr<RequestBuffer> buffer = std::move(this->free.back());
+			this->free.pop_back();
+			return buffer;
+		}
+
+		void give(std::unique_ptr<RequestBuffer> buffer)
+		{
+			// Keeping its capacity, for the next request with no payload
+			buffer->payload.clear();
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (this->free.size() < constants::pooled_request_buffers)
+			{
+				this->free.push_back(std::move(buffer));
+			}
+		}
+
+	private:
+		std::mutex mutex;
+		std::vector<std::unique_ptr<RequestBuffer>> free;
+	};
+
+	// Parses the JSON read into a buffer from the pool in place, the buffer going back to the pool with the document.
+	// Null if the JSON is not valid.
+	static inline std::shared_ptr<yyjson_doc> read_request(const std::shared_ptr<RequestBufferPool>& pool, std::unique_ptr<RequestBuffer> buffer)
+	{
+		const std::size_t json_size = buffer->json.size();
+		// Within the capacity left by earlier requests
+		buffer->json.append(YYJSON_PADDING_SIZE, '\0');
+		yyjson_doc* doc = yyjson_read_opts(buffer->json.data(), json_size, YYJSON_READ_INSITU, buffer->allocator.get(), nullptr);
+		if (doc == nullptr)
+		{
+			pool->give(std::move(buffer));
+			return nullptr;
+		}
+		return std::shared_ptr<yyjson_doc>(doc, [pool, buffer = buffer.release()](yyjson_doc* doc) {
+			yyjson_doc_free(doc);
+			pool->give(std::unique_ptr<RequestBuffer>(buffer));
+		});
+	}
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fmt/format.h>
+#include <picosha2.h>
+
+#include <kanban_markdown/trace.hpp>
+
+#include "constants.hpp"
+
+namespace server
+{
+	namespace save
+	{
+		// Of the whole content of a file. The Checksum line is not enough to tell files apart,
+		// an edit made outside this server leaving it as it was.
+		static inline std::string content_hash(std::string_view content)
+		{
+			return picosha2::hash256_hex_string(content.begin(), content.end());
+		}
+
+		// Whether the file holds exactly content
+		static inline bool holds(const std::string& file_path, std::string_view content)
+		{
+			std::ifstream file_stream(file_path, std::ios::binary | std::ios::ate);
+			if (!file_stream || static_cast<std::size_t>(file_stream.tellg()) != content.size())
+			{
+				return false;
+			}
+			file_stream.seekg(0);
+			std::string file_content(content.size(), '\0');
+			file_stream.read(file_content.data(), file_content.size());
+			return static_cast<std::size_t>(file_stream.gcount()) == content.size() && file_content == content;
+		}
+
+		// Flushes the file's data to the disk
+		static inline bool sync(std::FILE* file)
+		{
+#ifdef _WIN32
+			return _commit(_fileno(file)) == 0;
+#else
+			return ::fsync(fileno(file)) == 0;
+#endif
+		}
+
+		// Makes a rename in the directory survive a crash. Windows has no equivalent, its renames being journaled.
+		static inline void sync_directory(const std::filesystem::path& directory)
+		{
+#ifndef _WIN32
+			const int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (fd >= 0)
+			{
+				::fsync(fd);
+				::close(fd);
+			}
+#endif
+		}
+
+		// Gives the new file the permissions, and on POSIX the owner, of the file it replaces
+		static inline void copy_permissions(const std::filesystem::path& path, std::FILE* file, const std::filesystem::path& temporary_path)
+		{
+#ifdef _WIN32
+			std::error_code error_code;
+			const std::filesystem::file_status status = std::filesystem::status(path, error_code);
+			if (!error_code && std::filesystem::exists(status))
+			{
+				std::filesystem::permissions(temporary_path, status.permissions(), error_code);
+			}
+#else
+			struct stat original;
+			if (::stat(path.c_str(), &original) == 0)
+			{
+				::fchmod(fileno(file), original.st_mode & 07777);
+				// Only allowed to change the owner when running as root or the owner already, left as is otherwise
+				[[maybe_unused]] const int owned = ::fchown(fileno(file), original.st_uid, original.st_gid);
+			}
+#endif
+		}
+
+		// Writes to a temporary file next to the destination and renames it over the destination,
+		// so the file is never seen half written. With durable, the data and the rename are flushed to the disk,
+		// so the file is either the old one or the whole new one after a crash.
+		static inline void write_atomically(const std::string& file_path, const std::string& content, bool durable = true)
+		{
+			const std::filesystem::path path(file_path);
+			std::filesystem::path temporary_path = path;
+			temporary_path += ".kanban_md.tmp";
+			std::FILE* file = std::fopen(temporary_path.string().c_str(), "wb");
+			if (file == nullptr)
+			{
+				throw std::runtime_error(fmt::format(R"(Error: Unable to write to "{}": {})", temporary_path.string(), std::strerror(errno)));
+			}
+			copy_permissions(path, file, temporary_path);
+			bool written = std::fwrite(content.data(), 1, content.size(), file) == content.size() && std::fflush(file) == 0;
+			int error = errno;
+			if (written && durable && !sync(file))
+			{
+				written = false;
+				error = errno;
+			}
+			if (std::fclose(file) != 0 && written)
+			{
+				written = false;
+				error = errno;
+			}
+			if (!written)
+			{
+				std::error_code error_code;
+				std::filesystem::remove(temporary_path, error_code);
+				throw std::runtime_error(fmt::format(R"(Error: Unable to write to "{}": {})", temporary_path.string(), std::strerror(error)));
+			}
+			// The temporary file's entry and then the rename, each flushed so neither can be lost
+			if (durable)
+			{
+				sync_directory(path.parent_path());
+			}
+			std::filesystem::rename(temporary_path, path);
+			if (durable)
+			{
+				sync_directory(path.parent_path());
+			}
+		}
+	}
+
+	// Writes boards to their files on a background thread.
+	// A submitted save waits for the debounce delay and is replaced by any save of the same file submitted in the meantime,
+	// so a burst of command batches ends in one write.
+	class Saver
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		Saver()
+		{
+			this->thread = std::thread(&Saver::run, this);
+		}
+
+		~Saver()
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->stopping = true;
+			}
+			this->condition.notify_all();
+			this->thread.join();
+		}
+
+		Saver(const Saver&) = delete;
+		Saver& operator=(const Saver&) = delete;
+
+		void configure(bool auto_save, std::chrono::milliseconds debounce)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->auto_save_ = auto_save;
+			this->debounce = debounce;
+		}
+
+		bool auto_save()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			return this->auto_save_;
+		}
+
+		// markdown is the rendered board, taken as the snapshot to write.
+		void submit(const std::string& file_path, std::string markdown)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				Job& job = this->pending[file_path];
+				job.markdown = std::move(markdown);
+				job.deadline = Clock::now() + this->debounce;
+				job.generation = ++this->generations[file_path];
+			}
+			this->condition.notify_all();
+		}
+
+		// Writes markdown on the calling thread, replacing any save of the file still waiting, and throws if it could not be written.
+		void write(const std::string& file_path, const std::string& markdown)
+		{
+			std::uint64_t generation;
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->pending.erase(file_path);
+				generation = ++this->generations[file_path];
+			}
+			this->write_if_latest(file_path, markdown, generation);
+		}
+
+	private:
+		struct Job
+		{
+			std::string markdown;
+			Clock::time_point deadline;
+			std::uint64_t generation = 0;
+		};
+
+		// Writes unless a newer save of the file was submitted or written meanwhile, which an older one must not overwrite
+		void write_if_latest(const std::string& file_path, const std::string& markdown, std::uint64_t generation)
+		{
+			std::lock_guard<std::mutex> write_lock(this->write_mutex);
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				if (this->generations[file_path] != generation)
+				{
+					return;
+				}
+			}
+			// Nothing to do if the file already holds this board
+			if (!save::holds(file_path, markdown))
+			{
+				KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL("server", "write", file_path);
+				save::write_atomically(file_path, markdown);
+			}
+		}
+
+		void run()
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			while (true)
+			{
+				if (this->pending.empty())
+				{
+					if (this->stopping)
+					{
+						return;
+					}
+					this->condition.wait(lock);
+					continue;
+				}
+
+				auto next = this->pending.begin();
+				for (auto it = this->pending.begin(); it != this->pending.end(); ++it)
+				{
+					if (it->second.deadline < next->second.deadline)
+					{
+						next = it;
+					}
+				}
+				if (!this->stopping && Clock::now() < next->second.deadline)
+				{
+					this->condition.wait_until(lock, next->second.deadline);
+					continue;
+				}
+
+				const std::string file_path = next->first;
+				const std::string markdown = std::move(next->second.markdown);
+				const std::uint64_t generation = next->second.generation;
+				this->pending.erase(next);
+
+				lock.unlock();
+				try
+				{
+					this->write_if_latest(file_path, markdown, generation);
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << e.what() << '\n';
+				}
+				lock.lock();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::map<std::string, Job> pending;
+		// How many saves of each file were submitted or written, so one overtaken by a newer save is dropped
+		std::map<std::string, std::uint64_t> generations;
+		// Held while writing, and before mutex when both are
+		std::mutex write_mutex;
+		bool auto_save_ = false;
+		std::chrono::milliseconds debounce = constants::save_debounce;
+		bool stopping = false;
+		std::thread thread;
+	};
+}
@@ -6,6 +6,7 @@
 #include <filesystem>
 #include <sstream>
 #include <optional>
+#include <thread>
 
 #include <kanban_markdown/kanban_markdown.hpp>
 
@@ -16,6 +17,14 @@
 
 #include "constants.hpp"
 #include "internal.hpp"
+#include "executor.hpp"
+#include "framing.hpp"
+#include "pipeline.hpp"
+#include "save.hpp"
+#include "sessions.hpp"
+#include "socket.hpp"
+#include "stats.hpp"
+#include "watch.hpp"
 
 #include "commands/create.hpp"
 #include "commands/update.hpp"
@@ -28,122 +37,816 @@ namespace server
 	{
 	public:
 		KanbanServer() = default;
+
+		// Requests are read and parsed, executed, and answered on separate threads connected by queues,
+		// so reading a large request or writing a large response overlaps with executing the one before or after it.
+		// Up to max_in_flight of the client's requests are queued or running at once: requests for different boards run side by side on a pool,
+		// those for the same board in order (see Executor), and every response is written as soon as it is complete, tagged with the request's id.
 		void start()
 		{
-			yyjson_doc* doc = NULL;
-			std::string input;
-			std::optional<KanbanTuple> kanban_tuple;
+			SpscQueue<std::optional<Request>> requests(constants::pipeline_queue_size);
+			SpscQueue<std::optional<std::string>> responses(constants::pipeline_queue_size);
+			Client client{ std::make_shared<ClientOutput>([&responses](std::string chunk) { responses.push(std::move(chunk)); }) };
 
-			while (true)
-			{
-				std::getline(std::cin, input);
-				if (input.empty())
+			// Every request is read straight into a buffer from the client's pool, and parsed there
+			std::thread reader([&requests, buffers = client.buffers]() {
+				std::unique_ptr<RequestBuffer> buffer = buffers->take();
+				if (framing::mode() == framing::Mode::length_prefixed)
 				{
-					continue;
+					framing::Header header;
+					while (framing::read_header(stdin, header))
+					{
+						// The rest of the input cannot be told apart from the frame, so no more is read
+						if (framing::too_large(header))
+						{
+							requests.push(rejected_request(too_large(header.json_size + header.payload_size)));
+							break;
+						}
+						buffer->json.resize(header.json_size);
+						buffer->payload.resize(header.payload_size);
+						if (std::fread(buffer->json.data(), 1, header.json_size, stdin) != header.json_size || std::fread(buffer->payload.data(), 1, header.payload_size, stdin) != header.payload_size)
+						{
+							break;
+						}
+						requests.push(parse_request(buffers, std::move(buffer)));
+						buffer = buffers->take();
+					}
 				}
-				try
+				else
 				{
-					doc = yyjson_read(input.c_str(), input.size(), 0);
-					if (doc == NULL)
+					while (std::getline(std::cin, buffer->json))
 					{
-						throw std::runtime_error("The request made to the server is invalid; it must be in JSON format.");
+						if (!buffer->json.empty())
+						{
+							requests.push(parse_request(buffers, std::move(buffer)));
+							buffer = buffers->take();
+						}
 					}
-					yyjson_val* root = yyjson_doc_get_root(doc);
-					if (root == NULL)
+				}
+				buffers->give(std::move(buffer));
+				requests.push(std::nullopt);
+			});
+			std::thread writer([&responses]() {
+				while (std::optional<std::string> chunk = responses.pop())
+				{
+					fwrite(chunk->data(), 1, chunk->size(), stdout);
+					if (responses.empty())
 					{
-						throw std::runtime_error("The request made to the server is invalid; it must be in JSON format.");
+						fflush(stdout);
 					}
-					yyjson_val* id = yyjson_obj_get(root, "id");
-					if (id == NULL)
+				}
+				fflush(stdout);
+			});
+
+			{
+				Executor executor(kanban_markdown::internal::thread_count(constants::worker_threads));
+				this->start_watching(executor);
+				while (std::optional<Request> request = requests.pop())
+				{
+					executor.wait_below(*client.output);
+					this->dispatch(executor, client, std::move(*request));
+				}
+				this->stop_watching(executor);
+			}
+			responses.push(std::nullopt);
+
+			reader.join();
+			writer.join();
+		}
+
+#ifdef __linux__
+		// Serves the clients connecting to a Unix domain socket at path instead of stdin and stdout, until interrupted.
+		// Every client sees the same open boards.
+		void listen(const std::string& path)
+		{
+			socket::EventLoop loop(path);
+			// After the loop, so the requests still running finish before it goes
+			Executor executor(kanban_markdown::internal::thread_count(constants::worker_threads));
+			this->start_watching(executor);
+			loop.run([this, &executor](Client& client, std::unique_ptr<RequestBuffer> buffer) {
+				this->dispatch(executor, client, parse_request(client.buffers, std::move(buffer)));
+			}, [this, &executor](Client& client, std::size_t size) {
+				this->dispatch(executor, client, rejected_request(too_large(size)));
+			});
+			this->stop_watching(executor);
+		}
+#endif
+
+		// A request that is not JSON is kept without a document, to be answered with an error.
+		// The payload is in the request's buffer, kept alive by the document.
+		struct Request
+		{
+			std::shared_ptr<yyjson_doc> doc;
+			std::string_view payload;
+			// Set for a request refused before it was read, answered with it
+			std::string error;
+			std::size_t size = 0;
+			std::uint64_t parse_microseconds = 0;
+		};
+
+		// Parsed in place in the buffer the request was read into, so a request allocates nothing once the client's buffers have grown to its size
+		static Request parse_request(const std::shared_ptr<RequestBufferPool>& buffers, std::unique_ptr<RequestBuffer> buffer)
+		{
+			KANBAN_MARKDOWN_TRACE_SCOPE("server", "parse");
+			const stats::Timer timer;
+			Request request;
+			request.size = buffer->json.size() + buffer->payload.size();
+			const std::string_view payload = buffer->payload;
+			request.doc = read_request(buffers, std::move(buffer));
+			if (request.doc != nullptr)
+			{
+				request.payload = payload;
+			}
+			request.parse_microseconds = timer.microseconds();
+			return request;
+		}
+
+		static Request rejected_request(std::string error)
+		{
+			Request request;
+			request.error = std::move(error);
+			return request;
+		}
+
+		static std::string too_large(std::size_t size)
+		{
+			return fmt::format("Error: The request of {} bytes is larger than the {} bytes allowed, no more requests are read.", size, constants::max_frame_size);
+		}
+
+		// Submits a request from client to the strand of the board it is for, without waiting:
+		// the caller holds back the client's requests while its max_in_flight of them are in flight.
+		// Requests naming no board go to the last board the client named.
+		void dispatch(Executor& executor, Client& client, Request request)
+		{
+			yyjson_val* root = request.doc != nullptr ? yyjson_doc_get_root(request.doc.get()) : NULL;
+			const std::string_view type_str = root != NULL && yyjson_is_obj(root) ? yyjson_get_string_view(yyjson_obj_get(root, "type")) : std::string_view();
+			const std::size_t type_index = stats::request_type_index(type_str);
+			stats::ThreadStats& thread_stats = stats::local();
+			thread_stats.requests[type_index][stats::parse].record(request.parse_microseconds);
+			thread_stats.bytes_in[type_index].add(request.size);
+
+			if (root == NULL || !yyjson_is_obj(root) || !is_for_board(type_str))
+			{
+				executor.submit(client.output, std::string(), false, [this, type_index, output = client.output, request = std::move(request)]() { this->handle_recorded(type_index, request, std::string(), output); });
+				return;
+			}
+			// A request naming no board is for the last board the client named
+			std::string key = session_key(root);
+			if (key.empty())
+			{
+				key = client.last_key;
+			}
+			else
+			{
+				client.last_key = key;
+			}
+			if (key.empty())
+			{
+				// Rejected by handle without touching any board, so it can run inline
+				executor.submit(client.output, std::string(), false, [this, type_index, output = client.output, request = std::move(request)]() { this->handle_recorded(type_index, request, std::string(), output); });
+				return;
+			}
+			const bool read = is_read(root, type_str);
+			executor.submit(client.output, key, read, [this, key, type_index, output = client.output, request = std::move(request)]() { this->handle_recorded(type_index, request, key, output); });
+		}
+
+		// Runs handle, recording how long it took and how much it wrote under the request's type.
+		// The time spent writing JSON documents counts as serialize, responses streamed as they are built count as execute.
+		void handle_recorded(std::size_t type_index, const Request& request, const std::string& key, const std::shared_ptr<ClientOutput>& output)
+		{
+			stats::ThreadStats& thread_stats = stats::local();
+			ResponseOutput& response = response_output();
+			const std::uint64_t written = response.written;
+			thread_stats.serialize_microseconds = 0;
+			KANBAN_MARKDOWN_TRACE_SCOPE("request", stats::request_types[type_index]);
+			const stats::Timer timer;
+			if (request.error.empty())
+			{
+				this->handle(request.doc.get(), key, request.payload, output);
+			}
+			else
+			{
+				reject(request.error);
+			}
+			const std::uint64_t total = timer.microseconds();
+			const std::uint64_t serialize = std::min(total, thread_stats.serialize_microseconds);
+			thread_stats.requests[type_index][stats::execute].record(total - serialize);
+			thread_stats.requests[type_index][stats::serialize].record(serialize);
+			thread_stats.bytes_out[type_index].add(response.written - written + response.payload.size());
+		}
+
+		// Every request but the ones configuring the server or asking for its stats is for a board, and runs on its strand.
+		static bool is_for_board(std::string_view type_str)
+		{
+			return type_str != "configureSave" && type_str != "configureSessions" && type_str != "configureRequests" && type_str != "stats";
+		}
+
+		static void reject(const std::string& error)
+		{
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, root);
+			yyjson_mut_obj_add_bool(doc, root, "success", false);
+			yyjson_mut_obj_add_strcpy(doc, root, "error", error.c_str());
+			send_response(doc);
+		}
+
+		// Gets that only read the board, without filling its caches or JSON history, can share it with each other.
+		static bool is_read(yyjson_val* root, std::string_view type_str)
+		{
+			if (type_str != "get")
+			{
+				return false;
+			}
+			yyjson_val* format = yyjson_obj_get(root, "format");
+			if (format == NULL || !yyjson_is_str(format))
+			{
+				return false;
+			}
+			switch (hash(yyjson_get_string_view(format)))
+			{
+			case hash("json"):
+				return yyjson_obj_get(root, "version") == NULL;
+			case hash("ndjson"):
+			case hash("csv"):
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// key is the board the request is for, empty if the request is not for a board or the client never named one.
+		// payload holds the raw bytes sent after the JSON of a framed request, output is where the client's responses go.
+		void handle(yyjson_doc* doc, const std::string& key, std::string_view payload, const std::shared_ptr<ClientOutput>& output)
+		{
+			try
+			{
+				if (doc == NULL)
+				{
+					throw std::runtime_error("The request made to the server is invalid; it must be in JSON format.");
+				}
+				yyjson_val* root = yyjson_doc_get_root(doc);
+				if (root == NULL)
+				{
+					throw std::runtime_error("The request made to the server is invalid; it must be in JSON format.");
+				}
+				yyjson_val* id = yyjson_obj_get(root, "id");
+				if (id == NULL)
+				{
+					throw std::runtime_error("All requests made to the server require an ID to track the server's response.");
+				}
+				yyjson_val* type = yyjson_obj_get(root, "type");
+				if (type == NULL)
+				{
+					throw std::runtime_error("All requests made to the server require a type to determine the action to be taken.");
+				}
+				std::string id_str = yyjson_get_string_object(id);
+				std::string type_str = yyjson_get_string_object(type);
+				if (key.empty() && is_for_board(type_str))
+				{
+					throw std::runtime_error("Error: Missing required 'handle' or 'file' field naming the board, and no board was named by an earlier request.");
+				}
+				switch (hash(type_str))
+				{
+				case hash("parseFile"):
+				{
+					tl::expected<KanbanTuple, std::string> maybe_kanban_tuple = parseFile(root);
+					if (!maybe_kanban_tuple.has_value())
 					{
-						throw std::runtime_error("All requests made to the server require an ID to track the server's response.");
+						throw std::runtime_error(maybe_kanban_tuple.error());
 					}
-					yyjson_val* type = yyjson_obj_get(root, "type");
-					if (type == NULL)
+					else
 					{
-						throw std::runtime_error("All requests made to the server require a type to determine the action to be taken.");
+						KanbanTuple& kanban_tuple_ = maybe_kanban_tuple.value();
+						this->resubscribe(key, kanban_tuple_.file_path);
+						this->sessions.open(key, std::move(kanban_tuple_));
+						yyjson_mut_doc* doc = new_response_doc();
+						yyjson_mut_val* root = yyjson_mut_obj(doc);
+						yyjson_mut_doc_set_root(doc, root);
+						yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
+						yyjson_mut_obj_add_bool(doc, root, "success", true);
+						send_response(doc);
 					}
-					std::string id_str = yyjson_get_string_object(id);
-					std::string type_str = yyjson_get_string_object(type);
-					switch (hash(type_str))
+					break;
+				}
+				case hash("parseFileWithContent"):
+				{
+					tl::expected<KanbanTuple, std::string> maybe_kanban_tuple = parseFileWithContent(root, payload);
+					if (!maybe_kanban_tuple.has_value())
 					{
-					case hash("parseFile"):
+						throw std::runtime_error(maybe_kanban_tuple.error());
+					}
+					else
 					{
-						tl::expected<KanbanTuple, std::string> maybe_kanban_tuple = parseFile(root);
-						if (!maybe_kanban_tuple.has_value())
-						{
-							throw std::runtime_error(maybe_kanban_tuple.error());
-						}
-						else
+						KanbanTuple& kanban_tuple_ = maybe_kanban_tuple.value();
+						this->resubscribe(key, kanban_tuple_.file_path);
+						this->sessions.open(key, std::move(kanban_tuple_));
+						yyjson_mut_doc* doc = new_response_doc();
+						yyjson_mut_val* root = yyjson_mut_obj(doc);
+						yyjson_mut_doc_set_root(doc, root);
+						yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
+						yyjson_mut_obj_add_bool(doc, root, "success", true);
+						send_response(doc);
+					}
+					break;
+				}
+				case hash("configureSave"):
+				{
+					this->configureSave(root, id_str);
+					break;
+				}
+				case hash("configureSessions"):
+				{
+					this->configureSessions(root, id_str);
+					break;
+				}
+				case hash("configureRequests"):
+				{
+					this->configureRequests(root, id_str, output);
+					break;
+				}
+				case hash("stats"):
+				{
+					this->stats(id_str);
+					break;
+				}
+				case hash("watch"):
+				{
+					this->watch(root, key, output, id_str);
+					break;
+				}
+				case hash("close"):
+				{
+					this->unsubscribe(key);
+					this->sessions.close(key);
+					yyjson_mut_doc* doc = new_response_doc();
+					yyjson_mut_val* root = yyjson_mut_obj(doc);
+					yyjson_mut_doc_set_root(doc, root);
+					yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
+					yyjson_mut_obj_add_bool(doc, root, "success", true);
+					send_response(doc);
+					break;
+				}
+				case hash("save"):
+				{
+					this->save(*this->sessions.get(key), true);
+					yyjson_mut_doc* doc = new_response_doc();
+					yyjson_mut_val* root = yyjson_mut_obj(doc);
+					yyjson_mut_doc_set_root(doc, root);
+					yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
+					yyjson_mut_obj_add_bool(doc, root, "success", true);
+					send_response(doc);
+					break;
+				}
+				default:
+				{
+					std::shared_ptr<KanbanTuple> kanban_tuple = this->sessions.get(key);
+					KanbanTuple& kanban_tuple_ = *kanban_tuple;
+					bool modified = KanbanServer::withKanbanTuple(kanban_tuple_, root, id_str, type_str);
+					if (modified) {
+						kanban_tuple_.kanban_board.version += 1;
+						kanban_tuple_.kanban_board.last_modified = kanban_markdown::internal::now_utc();
+						if (this->saver.auto_save())
 						{
-							kanban_tuple = maybe_kanban_tuple.value();
-							yyjson_mut_doc* doc = yyjson_mut_doc_new(NULL);
-							yyjson_mut_val* root = yyjson_mut_obj(doc);
-							yyjson_mut_doc_set_root(doc, root);
-							yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
-							yyjson_mut_obj_add_bool(doc, root, "success", true);
-							const char* json = yyjson_mut_write(doc, 0, NULL);
-							printf("%s\n", json);
-							free((void*)json);
+							this->save(kanban_tuple_, false);
 						}
-						break;
 					}
-					case hash("parseFileWithContent"):
+					// Edits and the render caches filled by gets both change how much memory the board holds
+					this->sessions.resize(key);
+					break;
+				}
+				}
+			}
+			catch (const std::exception& e)
+			{
+				yyjson_mut_doc* response_doc = new_response_doc();
+				yyjson_mut_val* response_root = yyjson_mut_obj(response_doc);
+				yyjson_mut_doc_set_root(response_doc, response_root);
+				// Responses may come back in any order, so an error carries the id of its request whenever there is one
+				yyjson_val* id = doc != NULL && yyjson_is_obj(yyjson_doc_get_root(doc)) ? yyjson_obj_get(yyjson_doc_get_root(doc), "id") : NULL;
+				if (id != NULL && yyjson_is_str(id))
+				{
+					yyjson_mut_obj_add_strncpy(response_doc, response_root, "id", yyjson_get_str(id), yyjson_get_len(id));
+				}
+				yyjson_mut_obj_add_bool(response_doc, response_root, "success", false);
+				yyjson_mut_obj_add_str(response_doc, response_root, "error", e.what());
+				send_response(response_doc);
+			}
+		}
+
+		// Renders the board on this thread, the rendered markdown being the snapshot to write.
+		// An immediate save is written before returning and throws if it could not be, the others are left to the saver.
+		void save(KanbanTuple& kanban_tuple_, bool immediate)
+		{
+			KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL("server", "save", kanban_tuple_.file_path);
+			std::string md_string = kanban_markdown::writer::markdown::format_str(kanban_tuple_.kanban_board, kanban_tuple_.markdown_cache, markdown_flags());
+			remember_hash(kanban_tuple_, save::content_hash(md_string));
+			if (immediate)
+			{
+				this->saver.write(kanban_tuple_.file_path, md_string);
+				return;
+			}
+			this->saver.submit(kanban_tuple_.file_path, std::move(md_string));
+		}
+
+		// "autoSave" turns saving after every modifying command batch on or off, "debounce" is how many milliseconds to wait for more changes.
+		void configureSave(yyjson_val* root, std::string id_str)
+		{
+			yyjson_val* auto_save = yyjson_obj_get(root, "autoSave");
+			if (auto_save == NULL || !yyjson_is_bool(auto_save))
+			{
+				throw std::runtime_error("Error: Missing required boolean 'autoSave' field in root object.");
+			}
+			std::chrono::milliseconds debounce = constants::save_debounce;
+			yyjson_val* debounce_val = yyjson_obj_get(root, "debounce");
+			if (debounce_val != NULL)
+			{
+				if (!yyjson_is_uint(debounce_val))
+				{
+					throw std::runtime_error("Error: The 'debounce' field must be an unsigned integer.");
+				}
+				debounce = std::chrono::milliseconds(yyjson_get_uint(debounce_val));
+			}
+			this->saver.configure(yyjson_get_bool(auto_save), debounce);
+
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* new_root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, new_root);
+			yyjson_mut_obj_add_str(doc, new_root, "id", id_str.c_str());
+			yyjson_mut_obj_add_bool(doc, new_root, "success", true);
+			send_response(doc);
+		}
+
+		// Markdown is rendered with the lists of a board split over constants::render_threads.
+		static kanban_markdown::writer::markdown::Flags markdown_flags()
+		{
+			kanban_markdown::writer::markdown::Flags kanban_writer_flags;
+			kanban_writer_flags.threads = constants::render_threads;
+			return kanban_writer_flags;
+		}
+
+		// A request names its board by "handle" or else by "file", requests naming neither go to the last board named.
+		// Boards are opened by parseFile and parseFileWithContent under their handle, or their file path without one.
+		static std::string session_key(yyjson_val* root)
+		{
+			yyjson_val* handle = yyjson_obj_get(root, "handle");
+			if (handle != NULL && yyjson_is_str(handle))
+			{
+				return yyjson_get_string_object(handle);
+			}
+			yyjson_val* file = yyjson_obj_get(root, "file");
+			if (file != NULL && yyjson_is_str(file))
+			{
+				return yyjson_get_string_object(file);
+			}
+			return std::string();
+		}
+
+		// "memoryBudget" is how many bytes the open boards may use before the least recently used ones are evicted.
+		void configureSessions(yyjson_val* root, std::string id_str)
+		{
+			yyjson_val* memory_budget = yyjson_obj_get(root, "memoryBudget");
+			if (memory_budget == NULL || !yyjson_is_uint(memory_budget))
+			{
+				throw std::runtime_error("Error: Missing required unsigned integer 'memoryBudget' field in root object.");
+			}
+			this->sessions.configure(static_cast<std::size_t>(yyjson_get_uint(memory_budget)));
+
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* new_root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, new_root);
+			yyjson_mut_obj_add_str(doc, new_root, "id", id_str.c_str());
+			yyjson_mut_obj_add_bool(doc, new_root, "success", true);
+			send_response(doc);
+		}
+
+		// "maxInFlight" is how many of the client's requests may be queued or running at once, 1 running them one at a time.
+		// Only the client sending it is limited, other clients of the same server keeping their own limit.
+		void configureRequests(yyjson_val* root, std::string id_str, const std::shared_ptr<ClientOutput>& output)
+		{
+			yyjson_val* max_in_flight = yyjson_obj_get(root, "maxInFlight");
+			if (max_in_flight == NULL || !yyjson_is_uint(max_in_flight) || yyjson_get_uint(max_in_flight) == 0)
+			{
+				throw std::runtime_error("Error: Missing required positive integer 'maxInFlight' field in root object.");
+			}
+			output->set_max_in_flight(static_cast<std::size_t>(yyjson_get_uint(max_in_flight)));
+
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* new_root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, new_root);
+			yyjson_mut_obj_add_str(doc, new_root, "id", id_str.c_str());
+			yyjson_mut_obj_add_bool(doc, new_root, "success", true);
+			send_response(doc);
+		}
+
+		// "watch" false stops sending the client notifications for the board, true or leaving it out starts.
+		// A watched board is read again once its file is changed by something else, and every client watching it is sent
+		// {"notification": "fileChanged", "handle", "file", "version"}. A client can then get the board, or a patch from
+		// the version it has with get json and "version".
+		void watch(yyjson_val* root, const std::string& key, const std::shared_ptr<ClientOutput>& output, std::string id_str)
+		{
+			yyjson_val* enabled = yyjson_obj_get(root, "watch");
+			if (enabled != NULL && !yyjson_is_bool(enabled))
+			{
+				throw std::runtime_error("Error: The 'watch' field must be a boolean.");
+			}
+			std::shared_ptr<KanbanTuple> kanban_tuple = this->sessions.get(key);
+#ifdef __linux__
+			if (this->watcher == nullptr)
+			{
+				throw std::runtime_error("Error: Files are not being watched.");
+			}
+			std::lock_guard<std::mutex> lock(this->subscriptions_mutex);
+			auto it = this->subscriptions.find(key);
+			if (enabled == NULL || yyjson_get_bool(enabled))
+			{
+				if (it == this->subscriptions.end())
+				{
+					const std::string file_path = watch::normalize(kanban_tuple->file_path);
+					this->watcher->watch(file_path);
+					it = this->subscriptions.emplace(key, Subscription{ file_path }).first;
+				}
+				std::vector<std::weak_ptr<ClientOutput>>& outputs = it->second.outputs;
+				if (std::none_of(outputs.begin(), outputs.end(), [&output](const std::weak_ptr<ClientOutput>& watching) { return watching.lock() == output; }))
+				{
+					outputs.push_back(output);
+				}
+			}
+			else if (it != this->subscriptions.end())
+			{
+				std::vector<std::weak_ptr<ClientOutput>>& outputs = it->second.outputs;
+				outputs.erase(std::remove_if(outputs.begin(), outputs.end(), [&output](const std::weak_ptr<ClientOutput>& watching) { return watching.lock() == output; }), outputs.end());
+				if (outputs.empty())
+				{
+					this->watcher->unwatch(it->second.file_path);
+					this->subscriptions.erase(it);
+				}
+			}
+#else
+			throw std::runtime_error("Error: Watching files is only supported on Linux.");
+#endif
+
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* new_root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, new_root);
+			yyjson_mut_obj_add_str(doc, new_root, "id", id_str.c_str());
+			yyjson_mut_obj_add_bool(doc, new_root, "success", true);
+			yyjson_mut_obj_add_uint(doc, new_root, "version", kanban_tuple->kanban_board.version);
+			send_response(doc);
+		}
+
+		// Watches file_path instead for the clients watching the board under the key, as it is opened again
+		void resubscribe(const std::string& key, const std::string& file_path)
+		{
+#ifdef __linux__
+			std::lock_guard<std::mutex> lock(this->subscriptions_mutex);
+			auto it = this->subscriptions.find(key);
+			const std::string normalized = watch::normalize(file_path);
+			if (it == this->subscriptions.end() || this->watcher == nullptr || it->second.file_path == normalized)
+			{
+				return;
+			}
+			this->watcher->watch(normalized);
+			this->watcher->unwatch(it->second.file_path);
+			it->second.file_path = normalized;
+#endif
+		}
+
+		void unsubscribe(const std::string& key)
+		{
+#ifdef __linux__
+			std::lock_guard<std::mutex> lock(this->subscriptions_mutex);
+			auto it = this->subscriptions.find(key);
+			if (it == this->subscriptions.end())
+			{
+				return;
+			}
+			if (this->watcher != nullptr)
+			{
+				this->watcher->unwatch(it->second.file_path);
+			}
+			this->subscriptions.erase(it);
+#endif
+		}
+
+		// Watching is left out when inotify is unavailable, watch requests then failing
+		void start_watching(Executor& executor)
+		{
+#ifdef __linux__
+			try
+			{
+				this->watcher = std::make_unique<watch::FileWatcher>(constants::watch_debounce, [this, &executor](const std::string& file_path) {
+					this->file_changed(executor, file_path);
+				});
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << '\n';
+			}
+#endif
+		}
+
+		// Called before the executor goes, once no more requests are submitted
+		void stop_watching(Executor& executor)
+		{
+#ifdef __linux__
+			executor.wait_below(1);
+			this->watcher.reset();
+			std::lock_guard<std::mutex> lock(this->subscriptions_mutex);
+			this->subscriptions.clear();
+#endif
+		}
+
+#ifdef __linux__
+		// On the watcher's thread: each board open from the file is read again on its strand, after the requests already submitted for it
+		void file_changed(Executor& executor, const std::string& file_path)
+		{
+			std::vector<std::string> keys;
+			{
+				std::lock_guard<std::mutex> lock(this->subscriptions_mutex);
+				for (const auto& [key, subscription] : this->subscriptions)
+				{
+					if (subscription.file_path == file_path)
 					{
-						tl::expected<KanbanTuple, std::string> maybe_kanban_tuple = parseFileWithContent(root);
-						if (!maybe_kanban_tuple.has_value())
-						{
-							throw std::runtime_error(maybe_kanban_tuple.error());
-						}
-						else
-						{
-							kanban_tuple = maybe_kanban_tuple.value();
-							yyjson_mut_doc* doc = yyjson_mut_doc_new(NULL);
-							yyjson_mut_val* root = yyjson_mut_obj(doc);
-							yyjson_mut_doc_set_root(doc, root);
-							yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
-							yyjson_mut_obj_add_bool(doc, root, "success", true);
-							const char* json = yyjson_mut_write(doc, 0, NULL);
-							printf("%s\n", json);
-							free((void*)json);
-						}
-						break;
+						keys.push_back(key);
 					}
-					default:
+				}
+			}
+			for (const std::string& key : keys)
+			{
+				executor.submit(this->no_output, key, false, [this, key]() { this->reload(key); });
+			}
+		}
+#endif
+
+		// Reads the board under the key from its file again, unless the file holds what this server last read or wrote.
+		// The file wins over changes to the board that were not saved yet.
+		void reload(const std::string& key)
+		{
+			KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL("server", "reload", key);
+			std::shared_ptr<KanbanTuple> kanban_tuple;
+			try
+			{
+				kanban_tuple = this->sessions.get(key);
+			}
+			catch (const std::exception&)
+			{
+				// Closed since
+				return;
+			}
+			KanbanTuple& kanban_tuple_ = *kanban_tuple;
+
+			std::ifstream file_stream(kanban_tuple_.file_path, std::ios::binary);
+			if (!file_stream)
+			{
+				return;
+			}
+			std::stringstream buffer;
+			buffer << file_stream.rdbuf();
+			const std::string content_str = buffer.str();
+			file_stream.close();
+
+			std::string file_hash = save::content_hash(content_str);
+			if (std::find(kanban_tuple_.file_hashes.begin(), kanban_tuple_.file_hashes.end(), file_hash) != kanban_tuple_.file_hashes.end())
+			{
+				return;
+			}
+			tl::expected<kanban_markdown::KanbanBoard, std::string> maybe_kanban_board = kanban_markdown::reader::parse(content_str, kanban_tuple_.kanban_board.checksum_version);
+			if (!maybe_kanban_board.has_value())
+			{
+				std::cerr << fmt::format(R"(Error: Unable to read "{}" again: {})", kanban_tuple_.file_path, maybe_kanban_board.error()) << '\n';
+				return;
+			}
+
+			// A new version, so patches from the versions clients already have still apply
+			const unsigned int version = kanban_tuple_.kanban_board.version + 1;
+			kanban_tuple_.kanban_board = std::move(maybe_kanban_board.value());
+			kanban_tuple_.kanban_board.version = version;
+			// The caches point at the nodes of the board they were made from
+			kanban_tuple_.markdown_cache = kanban_markdown::writer::markdown::Cache();
+			kanban_tuple_.markdown_encoded = encoding::Cache();
+			remember_hash(kanban_tuple_, std::move(file_hash));
+			this->sessions.resize(key);
+			this->notify(key, kanban_tuple_);
+		}
+
+		void notify(const std::string& key, const KanbanTuple& kanban_tuple_)
+		{
+#ifdef __linux__
+			std::vector<std::shared_ptr<ClientOutput>> outputs;
+			{
+				std::lock_guard<std::mutex> lock(this->subscriptions_mutex);
+				auto it = this->subscriptions.find(key);
+				if (it == this->subscriptions.end())
+				{
+					return;
+				}
+				// Clients that have gone are dropped
+				std::vector<std::weak_ptr<ClientOutput>>& watching = it->second.outputs;
+				for (auto output = watching.begin(); output != watching.end(); )
+				{
+					if (std::shared_ptr<ClientOutput> locked = output->lock())
 					{
-						if (!kanban_tuple.has_value())
-						{
-							throw std::runtime_error("No kanban board has been parsed yet.");
-						}
-						else
-						{
-							KanbanTuple& kanban_tuple_ = kanban_tuple.value();
-							bool modified = KanbanServer::withKanbanTuple(kanban_tuple_, root, id_str, type_str);
-							if (modified) {
-								kanban_tuple_.kanban_board.version += 1;
-								kanban_tuple_.kanban_board.last_modified = kanban_markdown::internal::now_utc();
-							}
-						}
-						break;
+						outputs.push_back(std::move(locked));
+						++output;
 					}
+					else
+					{
+						output = watching.erase(output);
 					}
 				}
-				catch (const std::exception& e)
+			}
+
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, root);
+			yyjson_mut_obj_add_str(doc, root, "notification", "fileChanged");
+			yyjson_mut_obj_add_strncpy(doc, root, "handle", key.data(), key.size());
+			yyjson_mut_obj_add_strncpy(doc, root, "file", kanban_tuple_.file_path.data(), kanban_tuple_.file_path.size());
+			yyjson_mut_obj_add_uint(doc, root, "version", kanban_tuple_.kanban_board.version);
+			const std::string message = format_message(doc);
+			for (const std::shared_ptr<ClientOutput>& output : outputs)
+			{
+				const std::uint64_t sequence = output->sequence();
+				output->write(sequence, message);
+				output->finish(sequence);
+			}
+#endif
+		}
+
+		// Latency histograms in microseconds and byte counts for every request type that was seen, per phase,
+		// the time taken by every command action, and the size of the open boards.
+		void stats(std::string id_str)
+		{
+			std::vector<std::shared_ptr<stats::ThreadStats>> threads = stats::registry().all();
+
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, root);
+			yyjson_mut_obj_add_strcpy(doc, root, "id", id_str.c_str());
+
+			yyjson_mut_val* requests_obj = yyjson_mut_obj(doc);
+			for (std::size_t type_index = 0; type_index < stats::request_type_count; type_index++)
+			{
+				stats::Totals phases[stats::phase_count];
+				std::uint64_t bytes_in = 0;
+				std::uint64_t bytes_out = 0;
+				for (const auto& thread_stats : threads)
 				{
-					yyjson_mut_doc* doc = yyjson_mut_doc_new(NULL);
-					yyjson_mut_val* root = yyjson_mut_obj(doc);
-					yyjson_mut_doc_set_root(doc, root);
-					yyjson_mut_obj_add_bool(doc, root, "success", false);
-					yyjson_mut_obj_add_str(doc, root, "error", e.what());
-					const char* json = yyjson_mut_write(doc, 0, NULL);
-					printf("%s\n", json);
-					free((void*)json);
+					for (std::size_t phase = 0; phase < stats::phase_count; phase++)
+					{
+						phases[phase].add(thread_stats->requests[type_index][phase]);
+					}
+					bytes_in += thread_stats->bytes_in[type_index].get();
+					bytes_out += thread_stats->bytes_out[type_index].get();
 				}
-				if (doc != NULL)
+				if (phases[stats::parse].count == 0)
 				{
-					yyjson_doc_free(doc);
+					continue;
+				}
+				yyjson_mut_val* request_obj = yyjson_mut_obj(doc);
+				yyjson_mut_obj_add_uint(doc, request_obj, "count", phases[stats::parse].count);
+				yyjson_mut_obj_add_uint(doc, request_obj, "bytesIn", bytes_in);
+				yyjson_mut_obj_add_uint(doc, request_obj, "bytesOut", bytes_out);
+				for (std::size_t phase = 0; phase < stats::phase_count; phase++)
+				{
+					yyjson_mut_obj_add_val(doc, request_obj, stats::phase_names[phase], phases[phase].to_json(doc));
 				}
+				yyjson_mut_obj_add_val(doc, requests_obj, stats::request_types[type_index], request_obj);
+			}
+			yyjson_mut_obj_add_val(doc, root, "requests", requests_obj);
+
+			yyjson_mut_val* actions_obj = yyjson_mut_obj(doc);
+			for (std::size_t action_index = 0; action_index < stats::action_count; action_index++)
+			{
+				stats::Totals totals;
+				for (const auto& thread_stats : threads)
+				{
+					totals.add(thread_stats->actions[action_index]);
+				}
+				if (totals.count != 0)
+				{
+					yyjson_mut_obj_add_val(doc, actions_obj, stats::actions[action_index], totals.to_json(doc));
+				}
+			}
+			yyjson_mut_obj_add_val(doc, root, "actions", actions_obj);
+
+			yyjson_mut_val* sessions_obj = yyjson_mut_obj(doc);
+			std::size_t memory_used = 0;
+			yyjson_mut_val* boards_arr = yyjson_mut_arr(doc);
+			for (const Sessions::Usage& usage : this->sessions.usage())
+			{
+				yyjson_mut_val* board_obj = yyjson_mut_obj(doc);
+				yyjson_mut_obj_add_strncpy(doc, board_obj, "key", usage.key.c_str(), usage.key.size());
+				yyjson_mut_obj_add_uint(doc, board_obj, "size", usage.size);
+				yyjson_mut_obj_add_bool(doc, board_obj, "inMemory", usage.in_memory);
+				yyjson_mut_arr_append(boards_arr, board_obj);
+				memory_used += usage.in_memory ? usage.size : 0;
 			}
+			yyjson_mut_obj_add_uint(doc, sessions_obj, "memoryUsed", memory_used);
+			yyjson_mut_obj_add_val(doc, sessions_obj, "boards", boards_arr);
+			yyjson_mut_obj_add_val(doc, root, "sessions", sessions_obj);
+			send_response(doc);
 		}
 
 		static bool withKanbanTuple(KanbanTuple& kanban_tuple_, yyjson_val* root, std::string id_str, std::string type_str) {
@@ -170,67 +873,242 @@ namespace server
 			switch (hash(format_str))
 			{
 			case hash("json"):
-				return KanbanServer::get_json(kanban_tuple_, id_str);
+				return KanbanServer::get_json(kanban_tuple_, root, id_str);
 			case hash("markdown"):
-				return KanbanServer::get_markdown(kanban_tuple_, id_str);
+				return KanbanServer::get_markdown(kanban_tuple_, root, id_str);
+			case hash("html"):
+				return KanbanServer::get_html(kanban_tuple_, id_str);
+			case hash("ndjson"):
+				return KanbanServer::get_tasks(kanban_tuple_, id_str, kanban_markdown::writer::tasks::Format::ndjson, "ndjson");
+			case hash("csv"):
+				return KanbanServer::get_tasks(kanban_tuple_, id_str, kanban_markdown::writer::tasks::Format::csv, "csv");
 			default:
 				throw std::runtime_error(fmt::format(R"(Error: Unknown format type "{}".)", format_str));
 			}
 			return false;
 		}
 
-		static bool get_json(KanbanTuple& kanban_tuple_, std::string id_str) {
-			yyjson_mut_doc* new_doc = yyjson_mut_doc_new(nullptr);
+		// With a "version" field the response is a JSON Patch ("patch") from the JSON the client had at that version,
+		// or the whole board ("json") if that version is no longer known.
+		// Without it the board is streamed to the output and no copy is kept to patch against.
+		static bool get_json(KanbanTuple& kanban_tuple_, yyjson_val* root, std::string id_str) {
+			yyjson_val* version = yyjson_obj_get(root, "version");
+			if (version == NULL)
+			{
+				kanban_markdown::writer::json::Stream stream(write_response);
+				stream.raw("{");
+				stream.key("id");
+				stream.string(id_str);
+				stream.raw(",");
+				stream.key("version");
+				stream.uint(kanban_tuple_.kanban_board.version);
+				stream.raw(",");
+				stream.key("json");
+				kanban_markdown::writer::json::format(kanban_tuple_.kanban_board, stream);
+				stream.raw("}\n");
+				return false;
+			}
+			if (!yyjson_is_uint(version))
+			{
+				throw std::runtime_error("Error: The 'version' field must be an unsigned integer.");
+			}
+
+			yyjson_mut_doc* new_doc = new_response_doc();
+			yyjson_mut_val* kanban_board_object = yyjson_mut_obj(new_doc);
+			// The board is not modified before the response is written, so its strings are not copied
+			kanban_markdown::writer::json::Flags kanban_writer_flags;
+			kanban_writer_flags.copy_strings = false;
+			kanban_markdown::writer::json::format(kanban_tuple_.kanban_board, new_doc, kanban_board_object, kanban_writer_flags);
+
+			std::shared_ptr<yyjson_doc> previous_json = kanban_tuple_.json_history.find(static_cast<unsigned int>(yyjson_get_uint(version)));
+			std::shared_ptr<yyjson_doc> current_json;
+			try
+			{
+				yyjson_mut_doc_set_root(new_doc, kanban_board_object);
+				current_json = kanban_tuple_.json_history.push(kanban_tuple_.kanban_board.version, new_doc);
+			}
+			catch (...)
+			{
+				yyjson_mut_doc_free(new_doc);
+				throw;
+			}
+
 			yyjson_mut_val* new_root = yyjson_mut_obj(new_doc);
 			yyjson_mut_doc_set_root(new_doc, new_root);
 			yyjson_mut_obj_add_str(new_doc, new_root, "id", id_str.c_str());
-			yyjson_mut_val* kanban_board_object = yyjson_mut_obj(new_doc);
-			yyjson_mut_obj_add_val(new_doc, new_root, "json", kanban_board_object);
-			kanban_markdown::writer::json::format(kanban_tuple_.kanban_board, new_doc, kanban_board_object);
-			const char* json = yyjson_mut_write(new_doc, 0, nullptr);
-			printf("%s\n", json);
-			free((void*)json);
-			yyjson_mut_doc_free(new_doc);
+			yyjson_mut_obj_add_uint(new_doc, new_root, "version", kanban_tuple_.kanban_board.version);
+			if (previous_json != nullptr)
+			{
+				yyjson_mut_val* patch_array = yyjson_mut_arr(new_doc);
+				json_patch::Diff(new_doc, patch_array).value(yyjson_doc_get_root(previous_json.get()), yyjson_doc_get_root(current_json.get()), "");
+				yyjson_mut_obj_add_val(new_doc, new_root, "patch", patch_array);
+			}
+			else
+			{
+				yyjson_mut_obj_add_val(new_doc, new_root, "json", kanban_board_object);
+			}
+			send_response(new_doc);
 			return false;
 		}
 
-		static bool get_markdown(KanbanTuple& kanban_tuple_, std::string id_str) {
-			yyjson_mut_doc* new_doc = yyjson_mut_doc_new(nullptr);
+		// "encoding" is one of none, gzip-fast, gzip (the default with lines) or zstd, none being the default with frames.
+		// The encoded markdown is kept until the board's version changes, so asking again for the same version costs nothing.
+		static bool get_markdown(KanbanTuple& kanban_tuple_, yyjson_val* root, std::string id_str) {
+			const bool framed = framing::mode() == framing::Mode::length_prefixed;
+			encoding::Encoding requested = framed ? encoding::Encoding::none : encoding::Encoding::gzip;
+			yyjson_val* encoding_val = yyjson_obj_get(root, "encoding");
+			if (encoding_val != NULL)
+			{
+				requested = encoding::parse(yyjson_get_string_object(encoding_val));
+			}
+			const std::string& encoded = kanban_tuple_.markdown_encoded.get(kanban_tuple_.kanban_board.version, requested, [&kanban_tuple_]() {
+				return kanban_markdown::writer::markdown::format_str(kanban_tuple_.kanban_board, kanban_tuple_.markdown_cache, markdown_flags());
+			});
+
+			yyjson_mut_doc* new_doc = new_response_doc();
 			yyjson_mut_val* new_root = yyjson_mut_obj(new_doc);
 			yyjson_mut_doc_set_root(new_doc, new_root);
 			yyjson_mut_obj_add_str(new_doc, new_root, "id", id_str.c_str());
-			const std::string md_string = kanban_markdown::writer::markdown::format_str(kanban_tuple_.kanban_board);
-			const std::string compressed_md_string = gzip::compress(md_string.data(), md_string.size(), Z_BEST_COMPRESSION);
-			const std::string md_base64_string = base64::to_base64(compressed_md_string);
-			yyjson_mut_obj_add_str(new_doc, new_root, "markdown", md_base64_string.c_str());
-			const char* json = yyjson_mut_write(new_doc, 0, NULL);
-			printf("%s\n", json);
-			free((void*)json);
-			yyjson_mut_doc_free(new_doc);
+			yyjson_mut_obj_add_uint(new_doc, new_root, "version", kanban_tuple_.kanban_board.version);
+			yyjson_mut_obj_add_str(new_doc, new_root, "encoding", encoding::name(kanban_tuple_.markdown_encoded.used(requested)));
+			if (framed)
+			{
+				// Sent as is after the JSON
+				yyjson_mut_obj_add_str(new_doc, new_root, "payload", "markdown");
+				response_output().payload = encoded;
+			}
+			else
+			{
+				yyjson_mut_obj_add_strn(new_doc, new_root, "markdown", encoded.data(), encoded.size());
+			}
+			send_response(new_doc);
+			return false;
+		}
+
+		static bool get_html(KanbanTuple& kanban_tuple_, std::string id_str) {
+			const std::string html_string = kanban_markdown::writer::html::format_str(kanban_tuple_.kanban_board);
+			kanban_markdown::writer::json::Stream stream(write_response);
+			stream.raw("{");
+			stream.key("id");
+			stream.string(id_str);
+			stream.raw(",");
+			stream.key("version");
+			stream.uint(kanban_tuple_.kanban_board.version);
+			stream.raw(",");
+			stream.key("html");
+			stream.string(html_string);
+			stream.raw("}\n");
+			return false;
+		}
+
+		// The task records are escaped into the response string as they are written, so no copy of the export is kept.
+		static bool get_tasks(KanbanTuple& kanban_tuple_, std::string id_str, kanban_markdown::writer::tasks::Format format, std::string_view key) {
+			kanban_markdown::writer::json::Stream stream(write_response);
+			stream.raw("{");
+			stream.key("id");
+			stream.string(id_str);
+			stream.raw(",");
+			stream.key("version");
+			stream.uint(kanban_tuple_.kanban_board.version);
+			stream.raw(",");
+			stream.key(key);
+			stream.raw("\"");
+			{
+				kanban_markdown::writer::json::Stream records([&stream](const char* data, std::size_t size) { stream.escaped(std::string_view(data, size)); });
+				kanban_markdown::writer::tasks::Flags kanban_writer_flags;
+				kanban_writer_flags.format = format;
+				kanban_markdown::writer::tasks::format(kanban_tuple_.kanban_board, records, kanban_writer_flags);
+			}
+			stream.raw("\"}\n");
 			return false;
 		}
 
+		// The list, task and label a command went through or made, with the index of the list and task after the command.
+		static yyjson_mut_val* format_change(yyjson_mut_doc* doc, const kanban_markdown::KanbanBoard& kanban_board, const Change& change)
+		{
+			yyjson_mut_val* change_obj = yyjson_mut_obj(doc);
+			if (change.list != nullptr)
+			{
+				auto list_it = std::find(kanban_board.list.begin(), kanban_board.list.end(), change.list);
+				if (list_it != kanban_board.list.end())
+				{
+					yyjson_mut_val* list_obj = yyjson_mut_obj(doc);
+					yyjson_mut_obj_add_strncpy(doc, list_obj, "name", change.list->name.c_str(), change.list->name.size());
+					yyjson_mut_obj_add_uint(doc, list_obj, "counter", change.list->counter);
+					yyjson_mut_obj_add_bool(doc, list_obj, "checked", change.list->checked);
+					yyjson_mut_obj_add_uint(doc, list_obj, "index", std::distance(kanban_board.list.begin(), list_it));
+					yyjson_mut_obj_add_val(doc, change_obj, "list", list_obj);
+
+					auto task_it = std::find(change.list->tasks.begin(), change.list->tasks.end(), change.task);
+					if (change.task != nullptr && task_it != change.list->tasks.end())
+					{
+						yyjson_mut_val* task_obj = kanban_markdown::writer::json::format_task(doc, *change.task, kanban_markdown::writer::json::Flags());
+						yyjson_mut_obj_add_uint(doc, task_obj, "index", std::distance(change.list->tasks.begin(), task_it));
+						yyjson_mut_obj_add_val(doc, change_obj, "task", task_obj);
+					}
+				}
+			}
+			if (change.label != nullptr)
+			{
+				yyjson_mut_val* label_obj = yyjson_mut_obj(doc);
+				yyjson_mut_obj_add_strncpy(doc, label_obj, "name", change.label->name.c_str(), change.label->name.size());
+				yyjson_mut_obj_add_strncpy(doc, label_obj, "color", change.label->color.c_str(), change.label->color.size());
+				yyjson_mut_obj_add_val(doc, change_obj, "label", label_obj);
+			}
+			return change_obj;
+		}
+
+		// A batch that did not run, with the board's version so the client can catch up before sending it again
+		static void reject_commands(const std::string& id_str, unsigned int version, const std::string& error, bool conflict) {
+			yyjson_mut_doc* doc = new_response_doc();
+			yyjson_mut_val* root = yyjson_mut_obj(doc);
+			yyjson_mut_doc_set_root(doc, root);
+			yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
+			yyjson_mut_obj_add_bool(doc, root, "success", false);
+			if (conflict)
+			{
+				yyjson_mut_obj_add_bool(doc, root, "conflict", true);
+			}
+			yyjson_mut_obj_add_uint(doc, root, "version", version);
+			yyjson_mut_obj_add_strcpy(doc, root, "error", error.c_str());
+			send_response(doc);
+		}
+
+		// With "changes": true, the result of every command carries what it changed (see format_change),
+		// so the client can follow without getting the board again. The response has the version the board will have.
+		// With "expectedVersion", the commands only run if the board is still at that version, so a client can send
+		// batches without waiting for the ones before: a batch made stale by another client's edits is rejected with
+		// "conflict": true and the board's version, for the client to make again against the board as it is now.
 		static bool commands(KanbanTuple& kanban_tuple_, yyjson_val* root, std::string id_str) {
+			const unsigned int version = kanban_tuple_.kanban_board.version;
 			yyjson_val* commands = yyjson_obj_get(root, "commands");
 			if (!commands || !yyjson_is_arr(commands)) {
-				yyjson_mut_doc* doc = yyjson_mut_doc_new(NULL);
-				yyjson_mut_val* root = yyjson_mut_obj(doc);
-				yyjson_mut_doc_set_root(doc, root);
-				yyjson_mut_obj_add_str(doc, root, "id", id_str.c_str());
-				yyjson_mut_obj_add_bool(doc, root, "success", false);
-				const char* json = yyjson_mut_write(doc, 0, NULL);
-				printf("%s\n", json);
-				free((void*)json);
-				yyjson_mut_doc_free(doc);
+				reject_commands(id_str, version, "Error: Missing required 'commands' array in root object.", false);
 				return false;
 			}
-			yyjson_mut_doc* new_doc = yyjson_mut_doc_new(NULL);
+			yyjson_val* expected_version = yyjson_obj_get(root, "expectedVersion");
+			if (expected_version != NULL)
+			{
+				if (!yyjson_is_uint(expected_version))
+				{
+					reject_commands(id_str, version, "Error: The 'expectedVersion' field must be an unsigned integer.", false);
+					return false;
+				}
+				if (yyjson_get_uint(expected_version) != version)
+				{
+					reject_commands(id_str, version, fmt::format("Error: The board is at version {}, not {}.", version, yyjson_get_uint(expected_version)), true);
+					return false;
+				}
+			}
+
+			yyjson_mut_doc* new_doc = new_response_doc();
 			yyjson_mut_val* new_root = yyjson_mut_obj(new_doc);
 			yyjson_mut_doc_set_root(new_doc, new_root);
 			yyjson_mut_obj_add_str(new_doc, new_root, "id", id_str.c_str());
 			yyjson_mut_val* commands_array = yyjson_mut_arr(new_doc);
 			yyjson_mut_obj_add_val(new_doc, new_root, "commands", commands_array);
 
+			const bool with_changes = yyjson_get_bool(yyjson_obj_get(root, "changes"));
 			bool modified = false;
 
 			yyjson_val* command;
@@ -240,38 +1118,45 @@ namespace server
 				yyjson_mut_val* command_obj = yyjson_mut_obj(new_doc);
 
 				yyjson_val* action = yyjson_obj_get(command, "action");
+				// Failed on its own like any other command, as the ones before it may already have changed the board
 				if (action == NULL)
 				{
-					throw std::runtime_error(fmt::format(R"(Error: Missing required 'action' field in command object at index "{}")", idx));
+					yyjson_mut_obj_add_strcpy(new_doc, command_obj, "error", fmt::format(R"(Error: Missing required 'action' field in command object at index "{}")", idx).c_str());
+					yyjson_mut_obj_add_bool(new_doc, command_obj, "success", false);
+					yyjson_mut_arr_append(commands_array, command_obj);
+					continue;
 				}
 				std::string action_str = yyjson_get_string_object(action);
 				bool success = false;
+				Change change;
+				const stats::Timer action_timer;
 				try {
+					KANBAN_MARKDOWN_TRACE_SCOPE_DETAIL("command", "action", action_str);
 					switch (hash(action_str))
 					{
 					case hash("create"): {
-						commands::command_create(kanban_tuple_, command);
+						change = commands::command_create(kanban_tuple_, command);
 						modified = true;
 						success = true;
 						break;
 					}
 					case hash("update"):
 					{
-						commands::command_update(kanban_tuple_, command);
+						change = commands::command_update(kanban_tuple_, command);
 						modified = true;
 						success = true;
 						break;
 					}
 					case hash("delete"):
 					{
-						commands::command_delete(kanban_tuple_, command);
+						change = commands::command_delete(kanban_tuple_, command);
 						modified = true;
 						success = true;
 						break;
 					}
 					case hash("move"):
 					{
-						commands::command_move(kanban_tuple_, command);
+						change = commands::command_move(kanban_tuple_, command);
 						modified = true;
 						success = true;
 						break;
@@ -284,17 +1169,41 @@ namespace server
 				catch (const std::exception& e) {
 					yyjson_mut_obj_add_str(new_doc, command_obj, "error", e.what());
 				}
+				const std::size_t action_index = stats::action_index(action_str);
+				if (action_index < stats::action_count)
+				{
+					stats::local().actions[action_index].record(action_timer.microseconds());
+				}
 				yyjson_mut_obj_add_bool(new_doc, command_obj, "success", success);
+				if (with_changes && success)
+				{
+					yyjson_mut_obj_add_val(new_doc, command_obj, "changes", format_change(new_doc, kanban_tuple_.kanban_board, change));
+				}
 				yyjson_mut_arr_append(commands_array, command_obj);
 			}
+			// The version is bumped once the modified board is handed back
+			yyjson_mut_obj_add_uint(new_doc, new_root, "version", version + (modified ? 1 : 0));
 
-			const char* json = yyjson_mut_write(new_doc, 0, NULL);
-			printf("%s\n", json);
-			free((void*)json);
-			yyjson_mut_doc_free(new_doc);
+			send_response(new_doc);
 			return modified;
 		}
 
+		// A new board, read from a file without front matter, uses the optional "checksumVersion" (1 or 2) and Checksum Version 1 without it.
+		static unsigned int new_checksum_version(yyjson_val* root)
+		{
+			yyjson_val* checksum_version = yyjson_obj_get(root, "checksumVersion");
+			if (checksum_version == NULL)
+			{
+				return kanban_markdown::constants::checksum_version_sha256;
+			}
+			const uint64_t version = yyjson_is_uint(checksum_version) ? yyjson_get_uint(checksum_version) : 0;
+			if (version != kanban_markdown::constants::checksum_version_sha256 && version != kanban_markdown::constants::checksum_version_merkle)
+			{
+				throw std::runtime_error("Error: The 'checksumVersion' field must be 1 or 2.");
+			}
+			return static_cast<unsigned int>(version);
+		}
+
 		static tl::expected<KanbanTuple, std::string> parseFile(yyjson_val* root)
 		{
 			yyjson_val* file = yyjson_obj_get(root, "file");
@@ -316,7 +1225,7 @@ namespace server
 			file_stream.close();
 			buffer.clear();
 
-			tl::expected<kanban_markdown::KanbanBoard, std::string> maybe_kanban_board = kanban_markdown::reader::parse(content_str);
+			tl::expected<kanban_markdown::KanbanBoard, std::string> maybe_kanban_board = kanban_markdown::reader::parse(content_str, new_checksum_version(root));
 			if (!maybe_kanban_board.has_value())
 			{
 				return tl::make_unexpected(maybe_kanban_board.error());
@@ -325,10 +1234,12 @@ namespace server
 			KanbanTuple kanban_tuple;
 			kanban_tuple.file_path = file_path;
 			kanban_tuple.kanban_board = maybe_kanban_board.value();
+			remember_hash(kanban_tuple, save::content_hash(content_str));
 			return kanban_tuple;
 		}
 
-		static tl::expected<KanbanTuple, std::string> parseFileWithContent(yyjson_val* root)
+		// The content is gzip compressed and base64 encoded in the "content" field, or sent as is in the payload of a framed request.
+		static tl::expected<KanbanTuple, std::string> parseFileWithContent(yyjson_val* root, std::string_view payload)
 		{
 			yyjson_val* file = yyjson_obj_get(root, "file");
 			if (file == NULL)
@@ -336,7 +1247,7 @@ namespace server
 				throw std::runtime_error("Error: Missing required 'file' field in root object.");
 			}
 			yyjson_val* content = yyjson_obj_get(root, "content");
-			if (content == NULL)
+			if (content == NULL && payload.empty())
 			{
 				throw std::runtime_error("Error: Missing required 'content' field in root object.");
 			}
@@ -347,12 +1258,14 @@ namespace server
 				throw std::runtime_error(fmt::format(R"(Error: File path "{}" does not exist.)", file_path));
 			}
 
-			const std::string content_b64_str = yyjson_get_string_object(content);
-			const std::string content_compressed_str = base64::from_base64(content_b64_str);
-
-			const std::string content_str = gzip::decompress(content_compressed_str.c_str(), content_compressed_str.size());
-
-			tl::expected<kanban_markdown::KanbanBoard, std::string> maybe_kanban_board = kanban_markdown::reader::parse(content_str);
+			std::string content_str;
+			if (content != NULL)
+			{
+				const std::string content_compressed_str = base64::from_base64(yyjson_get_string_view(content));
+				content_str = gzip::decompress(content_compressed_str.c_str(), content_compressed_str.size());
+			}
+			std::string content_hash = save::content_hash(content != NULL ? std::string_view(content_str) : payload);
+			tl::expected<kanban_markdown::KanbanBoard, std::string> maybe_kanban_board = kanban_markdown::reader::parse(content != NULL ? std::move(content_str) : std::string(payload), new_checksum_version(root));
 			if (!maybe_kanban_board.has_value())
 			{
 				return tl::make_unexpected(maybe_kanban_board.error());
@@ -361,7 +1274,28 @@ namespace server
 			KanbanTuple kanban_tuple;
 			kanban_tuple.file_path = file_path;
 			kanban_tuple.kanban_board = maybe_kanban_board.value();
+			remember_hash(kanban_tuple, std::move(content_hash));
 			return kanban_tuple;
 		}
+
+	private:
+#ifdef __linux__
+		// The clients watching a board, by its key
+		struct Subscription
+		{
+			std::string file_path;
+			std::vector<std::weak_ptr<ClientOutput>> outputs;
+		};
+
+		std::mutex subscriptions_mutex;
+		std::unordered_map<std::string, Subscription> subscriptions;
+		// Set while serving
+		std::unique_ptr<watch::FileWatcher> watcher;
+		// Reloads answer no request, so nothing they write is sent
+		std::shared_ptr<ClientOutput> no_output = std::make_shared<ClientOutput>([](std::string) {});
+#endif
+		// Declared after the saver so open boards go first and saves they submitted are still written
+		Saver saver;
+		Sessions sessions;
 	};
 }
\ No newline at end of file
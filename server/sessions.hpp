@@ -0,0 +1,471 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <fmt/format.h>
+
+#include <kanban_markdown/kanban_markdown.hpp>
+
+#include "constants.hpp"
+#include "internal.hpp"
+
+namespace server
+{
+	namespace sessions
+	{
+		// Creates the file, only readable by this user and never through a link left in its place.
+		// Snapshots having unique names, there is nothing to replace atomically.
+		static inline void write_snapshot(const std::filesystem::path& path, const std::string& content)
+		{
+#ifdef _WIN32
+			std::ofstream file_stream(path, std::ios::binary);
+			if (!file_stream.write(content.data(), content.size()) || !file_stream.flush())
+			{
+				throw std::runtime_error(fmt::format(R"(Error: Unable to write to "{}".)", path.string()));
+			}
+#else
+			const int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+			if (file < 0)
+			{
+				throw std::runtime_error(fmt::format(R"(Error: Unable to write to "{}": {})", path.string(), std::strerror(errno)));
+			}
+			std::size_t written = 0;
+			while (written < content.size())
+			{
+				const ssize_t size = ::write(file, content.data() + written, content.size() - written);
+				if (size < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (size <= 0)
+				{
+					const int error = errno;
+					::close(file);
+					::unlink(path.c_str());
+					throw std::runtime_error(fmt::format(R"(Error: Unable to write to "{}": {})", path.string(), std::strerror(error)));
+				}
+				written += static_cast<std::size_t>(size);
+			}
+			::close(file);
+#endif
+		}
+
+		static inline std::size_t string_size(const std::string& string)
+		{
+			return sizeof(std::string) + string.capacity();
+		}
+
+		static inline std::size_t render_cache_size(const kanban_markdown::KanbanRenderCache& render_cache)
+		{
+			return sizeof(kanban_markdown::KanbanRenderCache) + render_cache.markdown.capacity() + render_cache.html.capacity();
+		}
+
+		// Bytes held by the board and the caches kept with it, counting the nodes and their strings.
+		// The JSON history is left out, yyjson not telling how large a document is.
+		static inline std::size_t approximate_size(const KanbanTuple& kanban_tuple)
+		{
+			const kanban_markdown::KanbanBoard& kanban_board = kanban_tuple.kanban_board;
+			std::size_t size = sizeof(KanbanTuple) + string_size(kanban_board.name) + string_size(kanban_board.description);
+			for (const auto& kanban_label : kanban_board.labels)
+			{
+				size += sizeof(kanban_markdown::KanbanLabel) + string_size(kanban_label->name) + string_size(kanban_label->color);
+				size += render_cache_size(kanban_label->render_cache) + kanban_label->tasks.capacity() * sizeof(void*) * 2;
+			}
+			for (const auto& kanban_list : kanban_board.list)
+			{
+				size += sizeof(kanban_markdown::KanbanList) + string_size(kanban_list->name) + render_cache_size(kanban_list->render_cache);
+				for (const auto& kanban_task : kanban_list->tasks)
+				{
+					size += sizeof(kanban_markdown::KanbanTask) + string_size(kanban_task->name) + render_cache_size(kanban_task->render_cache);
+					for (const std::string& description_line : kanban_task->description)
+					{
+						size += string_size(description_line);
+					}
+					for (const auto& kanban_attachment : kanban_task->attachments)
+					{
+						size += sizeof(kanban_markdown::KanbanAttachment) + string_size(kanban_attachment->name) + string_size(kanban_attachment->url);
+					}
+					for (const auto& kanban_checklist_item : kanban_task->checklist)
+					{
+						size += sizeof(kanban_markdown::KanbanChecklistItem) + string_size(kanban_checklist_item->name);
+					}
+					size += kanban_task->labels.capacity() * sizeof(void*) * 2;
+				}
+			}
+			size += kanban_tuple.markdown_encoded.capacity();
+			for (const auto& segment : kanban_tuple.markdown_cache.segments)
+			{
+				size += sizeof(segment) + segment.text.capacity() + segment.nodes.capacity() * sizeof(void*);
+			}
+			return size;
+		}
+	}
+
+	// Boards the client has opened, keyed by a handle the client chose or by their file path.
+	// Once the boards in memory add up to more than the memory budget, the least recently used ones are written
+	// to a binary snapshot and dropped, and read back from it the next time a request names them.
+	// Unsaved changes are kept in the snapshot. The most recently used board and boards a request is using are never evicted.
+	// Snapshots go in a directory of their own for each process, only readable by its user, and removed with the sessions.
+	// Safe to use from several threads, a board being kept alive by the pointer get returned.
+	// Snapshots are written outside the mutex, by whichever call evicted the board, and read back outside it by the get that wants it.
+	class Sessions
+	{
+	public:
+		Sessions() = default;
+
+		~Sessions()
+		{
+			if (!this->directory.empty())
+			{
+				std::error_code error_code;
+				std::filesystem::remove_all(this->directory, error_code);
+			}
+		}
+
+		Sessions(const Sessions&) = delete;
+		Sessions& operator=(const Sessions&) = delete;
+
+		void configure(std::size_t memory_budget)
+		{
+			std::vector<Evicted> evicted;
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->memory_budget = memory_budget;
+				evicted = this->evict();
+			}
+			this->write_snapshots(evicted);
+		}
+
+		// Replaces any board already open under the key.
+		std::shared_ptr<KanbanTuple> open(const std::string& key, KanbanTuple kanban_tuple)
+		{
+			std::shared_ptr<KanbanTuple> opened;
+			std::vector<Evicted> evicted;
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->erase(key);
+				Session& session = this->sessions[key];
+				session.kanban_tuple = std::make_shared<KanbanTuple>(std::move(kanban_tuple));
+				session.size = sessions::approximate_size(*session.kanban_tuple);
+				this->memory_used += session.size;
+				this->recent.push_front(key);
+				session.recent = this->recent.begin();
+				opened = session.kanban_tuple;
+				evicted = this->evict();
+			}
+			this->write_snapshots(evicted);
+			return opened;
+		}
+
+		// The board open under the key.
+		std::shared_ptr<KanbanTuple> get(const std::string& key)
+		{
+			std::shared_ptr<KanbanTuple> kanban_tuple;
+			std::vector<Evicted> evicted;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				auto it = this->sessions.find(key);
+				// A board whose snapshot is being written is taken back once the writing is done, rather than read back from it,
+				// and a board being read back by another get is waited for
+				while (it != this->sessions.end() && (it->second.evicting != nullptr || it->second.loading))
+				{
+					if (it->second.evicting != nullptr)
+					{
+						it->second.wanted = true;
+					}
+					this->settled.wait(lock);
+					it = this->sessions.find(key);
+				}
+				if (it == this->sessions.end())
+				{
+					throw std::runtime_error(fmt::format(R"(Error: No kanban board is open as "{}".)", key));
+				}
+				this->recent.splice(this->recent.begin(), this->recent, it->second.recent);
+				kanban_tuple = it->second.kanban_tuple;
+				if (kanban_tuple == nullptr)
+				{
+					// Read back outside the mutex, so requests for other boards do not wait for it
+					const std::filesystem::path snapshot_path = it->second.snapshot_path;
+					it->second.loading = true;
+					lock.unlock();
+					tl::expected<kanban_markdown::KanbanBoard, std::string> maybe_kanban_board = read_snapshot(snapshot_path);
+					lock.lock();
+					this->settled.notify_all();
+					it = this->sessions.find(key);
+					// Closed, or opened again, while it was read
+					if (it == this->sessions.end() || !it->second.loading || it->second.snapshot_path != snapshot_path)
+					{
+						throw std::runtime_error(fmt::format(R"(Error: No kanban board is open as "{}".)", key));
+					}
+					Session& session = it->second;
+					session.loading = false;
+					if (!maybe_kanban_board.has_value())
+					{
+						throw std::runtime_error(fmt::format(R"(Error: Unable to reload "{}": {})", session.file_path, maybe_kanban_board.error()));
+					}
+					this->install(session, std::move(maybe_kanban_board.value()));
+					kanban_tuple = session.kanban_tuple;
+					evicted = this->evict();
+				}
+			}
+			this->write_snapshots(evicted);
+			return kanban_tuple;
+		}
+
+		// Called after a request used the board under the key, as its size may have changed.
+		void resize(const std::string& key)
+		{
+			std::vector<Evicted> evicted;
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				auto it = this->sessions.find(key);
+				if (it == this->sessions.end() || it->second.kanban_tuple == nullptr)
+				{
+					return;
+				}
+				Session& session = it->second;
+				this->memory_used -= session.size;
+				session.size = sessions::approximate_size(*session.kanban_tuple);
+				this->memory_used += session.size;
+				evicted = this->evict();
+			}
+			this->write_snapshots(evicted);
+		}
+
+		void close(const std::string& key)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->erase(key);
+		}
+
+		struct Usage
+		{
+			std::string key;
+			std::size_t size;
+			bool in_memory;
+		};
+
+		// The open boards from the most to the least recently used, with their size when last in memory
+		std::vector<Usage> usage()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			std::vector<Usage> usage;
+			usage.reserve(this->recent.size());
+			for (const std::string& key : this->recent)
+			{
+				const Session& session = this->sessions.at(key);
+				usage.push_back(Usage{ key, session.size, session.kanban_tuple != nullptr });
+			}
+			return usage;
+		}
+
+	private:
+		struct Session
+		{
+			std::shared_ptr<KanbanTuple> kanban_tuple;
+			std::size_t size = 0;
+			std::string file_path;
+			std::deque<std::string> file_hashes;
+			std::filesystem::path snapshot_path;
+			std::list<std::string>::iterator recent;
+			// The board while its snapshot is being written, neither in memory nor in a snapshot
+			std::shared_ptr<KanbanTuple> evicting;
+			// Set by a get waiting for the board, which then stays in memory
+			bool wanted = false;
+			// Set while a get reads the board back from its snapshot, outside the mutex
+			bool loading = false;
+		};
+
+		// A board taken out of its session to be written to a snapshot
+		struct Evicted
+		{
+			std::string key;
+			std::shared_ptr<KanbanTuple> kanban_tuple;
+		};
+
+		// The functions below are called with the mutex held
+		void erase(const std::string& key)
+		{
+			auto it = this->sessions.find(key);
+			if (it == this->sessions.end())
+			{
+				return;
+			}
+			Session& session = it->second;
+			if (session.kanban_tuple != nullptr)
+			{
+				this->memory_used -= session.size;
+			}
+			if (!session.snapshot_path.empty())
+			{
+				std::error_code error_code;
+				std::filesystem::remove(session.snapshot_path, error_code);
+			}
+			this->recent.erase(session.recent);
+			this->sessions.erase(it);
+		}
+
+		// Takes the least recently used boards out of their sessions until the memory used is within the budget,
+		// for the caller to write them to snapshots once the mutex is released.
+		std::vector<Evicted> evict()
+		{
+			std::vector<Evicted> evicted;
+			if (this->recent.size() < 2)
+			{
+				return evicted;
+			}
+			// Oldest first, stopping before the most recently used board
+			for (auto it = std::prev(this->recent.end()); this->memory_used > this->memory_budget && it != this->recent.begin(); --it)
+			{
+				Session& session = this->sessions.at(*it);
+				// A board in use elsewhere holds another reference
+				if (session.kanban_tuple != nullptr && session.kanban_tuple.use_count() == 1)
+				{
+					session.evicting = std::move(session.kanban_tuple);
+					session.wanted = false;
+					this->memory_used -= session.size;
+					evicted.push_back(Evicted{ *it, session.evicting });
+				}
+			}
+			return evicted;
+		}
+
+		// Called without the mutex held
+		void write_snapshots(const std::vector<Evicted>& evicted)
+		{
+			if (evicted.empty())
+			{
+				return;
+			}
+			for (const Evicted& board : evicted)
+			{
+				bool written = false;
+				std::filesystem::path snapshot_path;
+				try
+				{
+					snapshot_path = this->snapshot_directory() / fmt::format("{:08x}-{}.kbmd", hash(board.key), this->snapshot_counter++);
+					// Not flushed to the disk, a snapshot being of no use once the process that wrote it is gone
+					sessions::write_snapshot(snapshot_path, kanban_markdown::writer::binary::format_str(board.kanban_tuple->kanban_board));
+					written = true;
+				}
+				catch (const std::exception& e)
+				{
+					// Kept in memory rather than losing its unsaved changes
+					std::cerr << e.what() << '\n';
+				}
+
+				std::lock_guard<std::mutex> lock(this->mutex);
+				auto it = this->sessions.find(board.key);
+				// Closed or opened again while the snapshot was written
+				const bool current = it != this->sessions.end() && it->second.evicting == board.kanban_tuple;
+				if (current && written && !it->second.wanted)
+				{
+					Session& session = it->second;
+					session.snapshot_path = snapshot_path;
+					session.file_path = session.evicting->file_path;
+					session.file_hashes = std::move(session.evicting->file_hashes);
+					session.evicting.reset();
+					continue;
+				}
+				if (current)
+				{
+					Session& session = it->second;
+					session.kanban_tuple = std::move(session.evicting);
+					session.wanted = false;
+					this->memory_used += session.size;
+				}
+				if (written)
+				{
+					std::error_code error_code;
+					std::filesystem::remove(snapshot_path, error_code);
+				}
+			}
+			this->settled.notify_all();
+		}
+
+		// Made on first use with a name no other process has, so servers for different windows never share a snapshot
+		std::filesystem::path snapshot_directory()
+		{
+			std::lock_guard<std::mutex> lock(this->directory_mutex);
+			if (this->directory.empty())
+			{
+#ifdef _WIN32
+				std::filesystem::path directory = std::filesystem::temp_directory_path() / fmt::format("kanban_md-{}", _getpid());
+				std::filesystem::create_directory(directory);
+				this->directory = directory;
+#else
+				// mkdtemp makes it with mode 0700
+				std::string directory = (std::filesystem::temp_directory_path() / "kanban_md-XXXXXX").string();
+				if (::mkdtemp(directory.data()) == nullptr)
+				{
+					throw std::runtime_error(fmt::format(R"(Error: Unable to make a directory for snapshots in "{}": {})", std::filesystem::temp_directory_path().string(), std::strerror(errno)));
+				}
+				this->directory = directory;
+#endif
+			}
+			return this->directory;
+		}
+
+		// Called without the mutex held
+		static tl::expected<kanban_markdown::KanbanBoard, std::string> read_snapshot(const std::filesystem::path& snapshot_path)
+		{
+			std::ifstream file_stream(snapshot_path, std::ios::binary);
+			std::stringstream buffer;
+			buffer << file_stream.rdbuf();
+			const std::string content_str = buffer.str();
+			file_stream.close();
+			return kanban_markdown::reader::binary::parse(content_str);
+		}
+
+		void install(Session& session, kanban_markdown::KanbanBoard kanban_board)
+		{
+			std::error_code error_code;
+			std::filesystem::remove(session.snapshot_path, error_code);
+			session.snapshot_path.clear();
+
+			session.kanban_tuple = std::make_shared<KanbanTuple>();
+			session.kanban_tuple->file_path = std::move(session.file_path);
+			session.kanban_tuple->file_hashes = std::move(session.file_hashes);
+			session.kanban_tuple->kanban_board = std::move(kanban_board);
+			session.size = sessions::approximate_size(*session.kanban_tuple);
+			this->memory_used += session.size;
+		}
+
+		std::mutex mutex;
+		// Notified once snapshots are written or read back, for a get waiting for its board
+		std::condition_variable settled;
+		std::unordered_map<std::string, Session> sessions;
+		// Keys from the most to the least recently used
+		std::list<std::string> recent;
+		std::size_t memory_used = 0;
+		std::size_t memory_budget = constants::session_memory_budget;
+		std::atomic<unsigned int> snapshot_counter = 0;
+		std::mutex directory_mutex;
+		std::filesystem::path directory;
+	};
+}
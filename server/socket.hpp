@@ -0,0 +1,455 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "executor.hpp"
+#include "framing.hpp"
+
+// Serves several clients, such as the windows of an editor, on a Unix domain socket with the same protocol as on stdin and stdout.
+// The clients share the server and so its open boards: a board open in several windows is held once.
+// One thread runs an epoll loop accepting clients, reading their requests and writing their responses,
+// the requests themselves run on the executor's pool.
+namespace server::socket
+{
+	// Responses waiting to be sent to a client, pushed by the pool threads and taken by the event loop
+	class Outbox
+	{
+	public:
+		void push(std::string chunk)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->pending += chunk;
+		}
+
+		void take(std::string& out)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			out += this->pending;
+			this->pending.clear();
+		}
+
+	private:
+		std::mutex mutex;
+		std::string pending;
+	};
+
+	class EventLoop
+	{
+	public:
+		// Receives every message a client sends, on the event loop thread, in a buffer from the client's pool
+		using OnMessage = std::function<void(Client& client, std::unique_ptr<RequestBuffer> buffer)>;
+		// Receives the size of a message larger than constants::max_frame_size, after which nothing more is read from the client
+		using OnTooLarge = std::function<void(Client& client, std::size_t size)>;
+
+		explicit EventLoop(const std::string& path) : path(path)
+		{
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(address.sun_path))
+			{
+				throw std::runtime_error(fmt::format(R"(Error: Socket path "{}" is too long.)", path));
+			}
+			std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+			// A socket file left by a server that is gone is replaced, one still accepting clients is not
+			const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			const bool in_use = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+			if (probe >= 0)
+			{
+				::close(probe);
+			}
+			if (in_use)
+			{
+				throw std::runtime_error(fmt::format(R"(Error: Another server is listening on "{}".)", path));
+			}
+			::unlink(path.c_str());
+
+			this->listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if (this->listener < 0)
+			{
+				throw std::runtime_error(fmt::format("Error: Unable to create a socket: {}", std::strerror(errno)));
+			}
+			if (::bind(this->listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(this->listener, SOMAXCONN) != 0)
+			{
+				const int error = errno;
+				::close(this->listener);
+				throw std::runtime_error(fmt::format(R"(Error: Unable to listen on "{}": {})", path, std::strerror(error)));
+			}
+
+			this->epoll = ::epoll_create1(EPOLL_CLOEXEC);
+			this->wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			stop_fd() = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			this->add(this->listener, listener_id, EPOLLIN);
+			this->add(this->wake, wake_id, EPOLLIN);
+			this->add(stop_fd(), stop_id, EPOLLIN);
+
+			struct sigaction action {};
+			action.sa_handler = &EventLoop::on_signal;
+			sigemptyset(&action.sa_mask);
+			::sigaction(SIGINT, &action, nullptr);
+			::sigaction(SIGTERM, &action, nullptr);
+			std::signal(SIGPIPE, SIG_IGN);
+		}
+
+		~EventLoop()
+		{
+			std::signal(SIGINT, SIG_DFL);
+			std::signal(SIGTERM, SIG_DFL);
+			for (auto& [id, connection] : this->connections)
+			{
+				::close(connection.fd);
+			}
+			::close(stop_fd());
+			stop_fd() = -1;
+			::close(this->wake);
+			::close(this->epoll);
+			::close(this->listener);
+			::unlink(this->path.c_str());
+		}
+
+		EventLoop(const EventLoop&) = delete;
+		EventLoop& operator=(const EventLoop&) = delete;
+
+		// Runs until the process is sent SIGINT or SIGTERM.
+		// A client with its max_in_flight requests in flight is not read from until one of them is done,
+		// so a client sending many slow requests holds back only its own.
+		void run(const OnMessage& on_message, const OnTooLarge& on_too_large)
+		{
+			epoll_event events[64];
+			while (true)
+			{
+				const int count = ::epoll_wait(this->epoll, events, 64, -1);
+				if (count < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw std::runtime_error(fmt::format("Error: epoll_wait failed: {}", std::strerror(errno)));
+				}
+				for (int i = 0; i < count; i++)
+				{
+					const std::uint64_t id = events[i].data.u64;
+					if (id == stop_id)
+					{
+						return;
+					}
+					if (id == listener_id)
+					{
+						this->accept();
+						continue;
+					}
+					if (id == wake_id)
+					{
+						std::uint64_t value;
+						while (::read(this->wake, &value, sizeof(value)) > 0)
+						{
+						}
+						for (auto it = this->connections.begin(); it != this->connections.end(); )
+						{
+							Connection& connection = it->second;
+							bool open = this->send(connection);
+							if (open && connection.paused && connection.client.output->in_flight() < connection.client.output->max_in_flight())
+							{
+								connection.paused = false;
+								this->update_events(connection);
+								this->take_messages(connection, on_message, on_too_large);
+							}
+							it = open ? std::next(it) : this->close(it);
+						}
+						continue;
+					}
+					auto it = this->connections.find(id);
+					if (it == this->connections.end())
+					{
+						continue;
+					}
+					bool open = (events[i].events & EPOLLERR) == 0;
+					if (open && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) != 0)
+					{
+						open = this->receive(it->second, on_message, on_too_large);
+					}
+					if (open && (events[i].events & EPOLLOUT) != 0)
+					{
+						open = this->send(it->second);
+					}
+					if (!open)
+					{
+						this->close(it);
+					}
+				}
+			}
+		}
+
+	private:
+		struct Connection
+		{
+			std::uint64_t id;
+			int fd;
+			Client client;
+			std::shared_ptr<Outbox> outbox;
+			// Read and not yet a whole message
+			std::string input;
+			// Taken from the outbox and not yet accepted by the socket
+			std::string unsent;
+			bool waiting_writable = false;
+			// Once the client sent a message too large to take, its responses are still sent but nothing more is read
+			bool input_closed = false;
+			// Not read from while too many of its requests are in flight
+			bool paused = false;
+		};
+
+		static constexpr std::uint64_t listener_id = 0;
+		static constexpr std::uint64_t wake_id = 1;
+		static constexpr std::uint64_t stop_id = 2;
+
+		// Written from the signal handler, which can only reach it through a global
+		static int& stop_fd()
+		{
+			static int fd = -1;
+			return fd;
+		}
+
+		static void on_signal(int)
+		{
+			const std::uint64_t one = 1;
+			[[maybe_unused]] const ssize_t written = ::write(stop_fd(), &one, sizeof(one));
+		}
+
+		void add(int fd, std::uint64_t id, std::uint32_t events)
+		{
+			epoll_event event{};
+			event.events = events;
+			event.data.u64 = id;
+			if (::epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+			{
+				throw std::runtime_error(fmt::format("Error: epoll_ctl failed: {}", std::strerror(errno)));
+			}
+		}
+
+		void accept()
+		{
+			while (true)
+			{
+				const int fd = ::accept4(this->listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (fd < 0)
+				{
+					return;
+				}
+				const std::uint64_t id = this->next_id++;
+				Connection& connection = this->connections[id];
+				connection.id = id;
+				connection.fd = fd;
+				connection.outbox = std::make_shared<Outbox>();
+				// The executor finishes the requests still running before the loop and its wake up fd go
+				connection.client.output = std::make_shared<ClientOutput>([outbox = connection.outbox, wake = this->wake](std::string chunk) {
+					outbox->push(std::move(chunk));
+					const std::uint64_t one = 1;
+					[[maybe_unused]] const ssize_t written = ::write(wake, &one, sizeof(one));
+				}, [wake = this->wake]() {
+					// To read from the client again if it was paused
+					const std::uint64_t one = 1;
+					[[maybe_unused]] const ssize_t written = ::write(wake, &one, sizeof(one));
+				});
+				this->add(fd, id, EPOLLIN | EPOLLRDHUP);
+			}
+		}
+
+		// False once the client has gone
+		bool receive(Connection& connection, const OnMessage& on_message, const OnTooLarge& on_too_large)
+		{
+			if (connection.input_closed)
+			{
+				// Only woken once the client has gone
+				return false;
+			}
+			char buffer[64 * 1024];
+			bool open = true;
+			while (true)
+			{
+				const ssize_t size = ::read(connection.fd, buffer, sizeof(buffer));
+				if (size > 0)
+				{
+					connection.input.append(buffer, static_cast<std::size_t>(size));
+					// Enough to tell a message is too large, the rest being read once the messages before it are taken
+					if (connection.input.size() > constants::max_frame_size + framing::header_size)
+					{
+						break;
+					}
+					continue;
+				}
+				if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				{
+					break;
+				}
+				if (size < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				open = false;
+				break;
+			}
+			this->take_messages(connection, on_message, on_too_large);
+			return open;
+		}
+
+		// Passes on the whole messages read, until the client has its max_in_flight requests in flight
+		void take_messages(Connection& connection, const OnMessage& on_message, const OnTooLarge& on_too_large)
+		{
+			// Stops reading from the client, the messages left being taken once it is resumed
+			const auto pause = [this, &connection]() {
+				if (connection.client.output->in_flight() < connection.client.output->max_in_flight())
+				{
+					return false;
+				}
+				connection.paused = true;
+				this->update_events(connection);
+				return true;
+			};
+			std::size_t offset = 0;
+			if (framing::mode() == framing::Mode::length_prefixed)
+			{
+				framing::Header header;
+				while (!connection.input_closed && framing::read_header(std::string_view(connection.input).substr(offset), header))
+				{
+					if (framing::too_large(header))
+					{
+						this->close_input(connection);
+						on_too_large(connection.client, header.json_size + header.payload_size);
+						return;
+					}
+					if (connection.input.size() - offset - framing::header_size < header.json_size + header.payload_size || pause())
+					{
+						break;
+					}
+					const char* json = connection.input.data() + offset + framing::header_size;
+					std::unique_ptr<RequestBuffer> buffer = connection.client.buffers->take();
+					buffer->json.assign(json, header.json_size);
+					buffer->payload.assign(json + header.json_size, header.payload_size);
+					offset += framing::header_size + header.json_size + header.payload_size;
+					on_message(connection.client, std::move(buffer));
+				}
+			}
+			else
+			{
+				bool paused = false;
+				for (std::size_t end = connection.input.find('\n', offset); !connection.input_closed && end != std::string::npos; end = connection.input.find('\n', offset))
+				{
+					if (end > offset)
+					{
+						if (pause())
+						{
+							paused = true;
+							break;
+						}
+						std::unique_ptr<RequestBuffer> buffer = connection.client.buffers->take();
+						buffer->json.assign(connection.input, offset, end - offset);
+						on_message(connection.client, std::move(buffer));
+					}
+					offset = end + 1;
+				}
+				if (!paused && !connection.input_closed && connection.input.size() - offset > constants::max_frame_size)
+				{
+					const std::size_t size = connection.input.size() - offset;
+					this->close_input(connection);
+					on_too_large(connection.client, size);
+					return;
+				}
+			}
+			if (!connection.input_closed)
+			{
+				connection.input.erase(0, offset);
+			}
+		}
+
+		void close_input(Connection& connection)
+		{
+			connection.input_closed = true;
+			connection.input.clear();
+			connection.input.shrink_to_fit();
+			::shutdown(connection.fd, SHUT_RD);
+			this->update_events(connection);
+		}
+
+		// Reading while the input is open and not paused, and told when the socket has room again while there is something left to send.
+		// Otherwise, a connection is still told when the client has gone.
+		void update_events(Connection& connection)
+		{
+			epoll_event event{};
+			event.events = (connection.input_closed || connection.paused ? 0 : EPOLLIN | EPOLLRDHUP) | (connection.waiting_writable ? EPOLLOUT : 0);
+			event.data.u64 = connection.id;
+			::epoll_ctl(this->epoll, EPOLL_CTL_MOD, connection.fd, &event);
+		}
+
+		// False once the client has gone
+		bool send(Connection& connection)
+		{
+			connection.outbox->take(connection.unsent);
+			std::size_t offset = 0;
+			while (offset < connection.unsent.size())
+			{
+				const ssize_t size = ::send(connection.fd, connection.unsent.data() + offset, connection.unsent.size() - offset, MSG_NOSIGNAL);
+				if (size >= 0)
+				{
+					offset += static_cast<std::size_t>(size);
+					continue;
+				}
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					return false;
+				}
+				break;
+			}
+			connection.unsent.erase(0, offset);
+			const bool waiting_writable = !connection.unsent.empty();
+			if (waiting_writable != connection.waiting_writable)
+			{
+				connection.waiting_writable = waiting_writable;
+				this->update_events(connection);
+			}
+			return true;
+		}
+
+		// Responses to requests still running are dropped, their outbox outliving the connection
+		std::unordered_map<std::uint64_t, Connection>::iterator close(std::unordered_map<std::uint64_t, Connection>::iterator it)
+		{
+			::epoll_ctl(this->epoll, EPOLL_CTL_DEL, it->second.fd, nullptr);
+			::close(it->second.fd);
+			return this->connections.erase(it);
+		}
+
+		std::string path;
+		int listener = -1;
+		int epoll = -1;
+		int wake = -1;
+		std::uint64_t next_id = stop_id + 1;
+		std::unordered_map<std::uint64_t, Connection> connections;
+	};
+}
+
+#endif
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <yyjson.h>
+
+// Latency histograms and byte counters, cheap enough to always be on.
+// Every thread records into its own counters, only ever written by that thread, and a stats request adds them all up.
+namespace server::stats
+{
+	enum Phase
+	{
+		parse,
+		execute,
+		serialize,
+		phase_count,
+	};
+
+	static constexpr const char* phase_names[] = { "parse", "execute", "serialize" };
+
+	// Requests of any other type, or that are not JSON, are counted as other
+	static constexpr const char* request_types[] = {
+		"parseFile", "parseFileWithContent", "configureSave", "configureSessions", "configureRequests", "close", "save", "get", "commands", "watch", "stats", "other",
+	};
+	static constexpr std::size_t request_type_count = sizeof(request_types) / sizeof(request_types[0]);
+
+	static constexpr const char* actions[] = { "create", "update", "delete", "move" };
+	static constexpr std::size_t action_count = sizeof(actions) / sizeof(actions[0]);
+
+	static inline std::size_t request_type_index(std::string_view type)
+	{
+		for (std::size_t i = 0; i + 1 < request_type_count; i++)
+		{
+			if (type == request_types[i])
+			{
+				return i;
+			}
+		}
+		return request_type_count - 1;
+	}
+
+	// action_count for an unknown action
+	static inline std::size_t action_index(std::string_view action)
+	{
+		for (std::size_t i = 0; i < action_count; i++)
+		{
+			if (action == actions[i])
+			{
+				return i;
+			}
+		}
+		return action_count;
+	}
+
+	// Bucket i counts durations under 2^i microseconds not counted by the bucket before, the last one everything longer.
+	static constexpr std::size_t bucket_count = 32;
+
+	// Only the owning thread adds to a counter, so a relaxed load and store is enough and other threads can still read it.
+	class Counter
+	{
+	public:
+		void add(std::uint64_t value)
+		{
+			this->value.store(this->value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+
+		std::uint64_t get() const
+		{
+			return this->value.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<std::uint64_t> value = 0;
+	};
+
+	class Histogram
+	{
+	public:
+		void record(std::uint64_t microseconds)
+		{
+			std::size_t bucket = 0;
+			while (bucket + 1 < bucket_count && microseconds >= (std::uint64_t(1) << bucket))
+			{
+				bucket++;
+			}
+			this->buckets[bucket].add(1);
+			this->sum.add(microseconds);
+		}
+
+		Counter buckets[bucket_count];
+		Counter sum;
+	};
+
+	// The histograms of every thread added up
+	struct Totals
+	{
+		std::uint64_t buckets[bucket_count] = {};
+		std::uint64_t count = 0;
+		std::uint64_t sum = 0;
+
+		void add(const Histogram& histogram)
+		{
+			for (std::size_t i = 0; i < bucket_count; i++)
+			{
+				const std::uint64_t value = histogram.buckets[i].get();
+				this->buckets[i] += value;
+				this->count += value;
+			}
+			this->sum += histogram.sum.get();
+		}
+
+		// The upper bound in microseconds of the bucket holding the quantile q
+		std::uint64_t quantile(double q) const
+		{
+			const std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(this->count));
+			std::uint64_t seen = 0;
+			for (std::size_t i = 0; i < bucket_count; i++)
+			{
+				seen += this->buckets[i];
+				if (seen > rank)
+				{
+					return std::uint64_t(1) << i;
+				}
+			}
+			return std::uint64_t(1) << (bucket_count - 1);
+		}
+
+		yyjson_mut_val* to_json(yyjson_mut_doc* doc) const
+		{
+			yyjson_mut_val* obj = yyjson_mut_obj(doc);
+			yyjson_mut_obj_add_uint(doc, obj, "count", this->count);
+			yyjson_mut_obj_add_uint(doc, obj, "totalMicroseconds", this->sum);
+			yyjson_mut_obj_add_uint(doc, obj, "p50", this->quantile(0.5));
+			yyjson_mut_obj_add_uint(doc, obj, "p90", this->quantile(0.9));
+			yyjson_mut_obj_add_uint(doc, obj, "p99", this->quantile(0.99));
+			// Trailing empty buckets are left out
+			std::size_t used = bucket_count;
+			while (used > 0 && this->buckets[used - 1] == 0)
+			{
+				used--;
+			}
+			yyjson_mut_val* buckets_arr = yyjson_mut_arr(doc);
+			for (std::size_t i = 0; i < used; i++)
+			{
+				yyjson_mut_arr_add_uint(doc, buckets_arr, this->buckets[i]);
+			}
+			yyjson_mut_obj_add_val(doc, obj, "buckets", buckets_arr);
+			return obj;
+		}
+	};
+
+	struct ThreadStats
+	{
+		Histogram requests[request_type_count][phase_count];
+		Histogram actions[action_count];
+		Counter bytes_in[request_type_count];
+		Counter bytes_out[request_type_count];
+		// Time spent writing responses by the request running on this thread
+		std::uint64_t serialize_microseconds = 0;
+	};
+
+	class Registry
+	{
+	public:
+		std::shared_ptr<ThreadStats> add()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->threads.push_back(std::make_shared<ThreadStats>());
+			return this->threads.back();
+		}
+
+		// Kept after their thread ends, so nothing recorded is lost
+		std::vector<std::shared_ptr<ThreadStats>> all()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			return this->threads;
+		}
+
+	private:
+		std::mutex mutex;
+		std::vector<std::shared_ptr<ThreadStats>> threads;
+	};
+
+	static inline Registry& registry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	static inline ThreadStats& local()
+	{
+		thread_local std::shared_ptr<ThreadStats> thread_stats = registry().add();
+		return *thread_stats;
+	}
+
+	class Timer
+	{
+	public:
+		std::uint64_t microseconds() const
+		{
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->start).count());
+		}
+
+	private:
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	};
+}
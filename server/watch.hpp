@@ -0,0 +1,222 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+// Tells when files are changed by something other than this server, such as another editor or a git pull.
+// The directory holding a file is watched rather than the file itself, editors and this server's saves
+// replacing a file by renaming a new one over it, which a watch on the file would not survive.
+namespace server::watch
+{
+	// The path a file is watched under, the same whichever way it was named
+	static inline std::string normalize(const std::string& file_path)
+	{
+		std::error_code error_code;
+		std::filesystem::path path = std::filesystem::absolute(file_path, error_code);
+		return (error_code ? std::filesystem::path(file_path) : path).lexically_normal().string();
+	}
+
+	class FileWatcher
+	{
+	public:
+		// Receives each changed file once no more events came for it for debounce, on the watcher's thread
+		using OnChange = std::function<void(const std::string& file_path)>;
+
+		FileWatcher(std::chrono::milliseconds debounce, OnChange on_change) : debounce(debounce), on_change(std::move(on_change))
+		{
+			this->inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (this->inotify < 0)
+			{
+				throw std::runtime_error(fmt::format("Error: Unable to watch files: {}", std::strerror(errno)));
+			}
+			this->stop = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			this->thread = std::thread(&FileWatcher::run, this);
+		}
+
+		~FileWatcher()
+		{
+			const std::uint64_t one = 1;
+			[[maybe_unused]] const ssize_t written = ::write(this->stop, &one, sizeof(one));
+			this->thread.join();
+			::close(this->stop);
+			::close(this->inotify);
+		}
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// Counted, a file watched twice being watched until unwatched twice. file_path must be normalized.
+		void watch(const std::string& file_path)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (this->files[file_path]++ > 0)
+			{
+				return;
+			}
+			const std::string directory = std::filesystem::path(file_path).parent_path().string();
+			Directory& watched = this->directories[directory];
+			if (watched.files++ == 0)
+			{
+				watched.descriptor = ::inotify_add_watch(this->inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+				if (watched.descriptor < 0)
+				{
+					const int error = errno;
+					this->directories.erase(directory);
+					this->files.erase(file_path);
+					throw std::runtime_error(fmt::format(R"(Error: Unable to watch "{}": {})", directory, std::strerror(error)));
+				}
+				this->by_descriptor[watched.descriptor] = directory;
+			}
+		}
+
+		void unwatch(const std::string& file_path)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			auto file = this->files.find(file_path);
+			if (file == this->files.end() || --file->second > 0)
+			{
+				return;
+			}
+			this->files.erase(file);
+			this->pending.erase(file_path);
+			auto directory = this->directories.find(std::filesystem::path(file_path).parent_path().string());
+			if (directory != this->directories.end() && --directory->second.files == 0)
+			{
+				::inotify_rm_watch(this->inotify, directory->second.descriptor);
+				this->by_descriptor.erase(directory->second.descriptor);
+				this->directories.erase(directory);
+			}
+		}
+
+	private:
+		struct Directory
+		{
+			int descriptor = -1;
+			std::size_t files = 0;
+		};
+
+		void run()
+		{
+			alignas(inotify_event) char buffer[16 * 1024];
+			while (true)
+			{
+				pollfd fds[2] = { { this->inotify, POLLIN, 0 }, { this->stop, POLLIN, 0 } };
+				if (::poll(fds, 2, this->timeout()) < 0 && errno != EINTR)
+				{
+					return;
+				}
+				if ((fds[1].revents & POLLIN) != 0)
+				{
+					return;
+				}
+				if ((fds[0].revents & POLLIN) != 0)
+				{
+					ssize_t size;
+					while ((size = ::read(this->inotify, buffer, sizeof(buffer))) > 0)
+					{
+						this->read_events(buffer, static_cast<std::size_t>(size));
+					}
+				}
+				for (const std::string& file_path : this->take_due())
+				{
+					this->on_change(file_path);
+				}
+			}
+		}
+
+		void read_events(const char* buffer, std::size_t size)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			const auto due = std::chrono::steady_clock::now() + this->debounce;
+			for (std::size_t offset = 0; offset < size; )
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+				auto directory = this->by_descriptor.find(event->wd);
+				if (directory == this->by_descriptor.end() || event->len == 0)
+				{
+					continue;
+				}
+				const std::string file_path = (std::filesystem::path(directory->second) / event->name).string();
+				if (this->files.count(file_path) > 0)
+				{
+					// Every event restarts the wait, so a file written in several steps is read once
+					this->pending[file_path] = due;
+				}
+			}
+		}
+
+		// Milliseconds until the next file is due, or -1 for none
+		int timeout()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (this->pending.empty())
+			{
+				return -1;
+			}
+			auto next = std::chrono::steady_clock::time_point::max();
+			for (const auto& [file_path, due] : this->pending)
+			{
+				next = std::min(next, due);
+			}
+			const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count();
+			return remaining > 0 ? static_cast<int>(remaining) + 1 : 0;
+		}
+
+		std::vector<std::string> take_due()
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			const auto now = std::chrono::steady_clock::now();
+			std::vector<std::string> due;
+			for (auto it = this->pending.begin(); it != this->pending.end(); )
+			{
+				if (it->second > now)
+				{
+					++it;
+					continue;
+				}
+				due.push_back(it->first);
+				it = this->pending.erase(it);
+			}
+			return due;
+		}
+
+		std::chrono::milliseconds debounce;
+		OnChange on_change;
+		int inotify = -1;
+		int stop = -1;
+		std::mutex mutex;
+		// How many times each file is watched
+		std::unordered_map<std::string, std::size_t> files;
+		std::unordered_map<std::string, Directory> directories;
+		std::unordered_map<int, std::string> by_descriptor;
+		// Changed files, with when they are due if nothing else changes them
+		std::map<std::string, std::chrono::steady_clock::time_point> pending;
+		// Last, so it starts once everything it uses is constructed
+		std::thread thread;
+	};
+}
+
+#endif
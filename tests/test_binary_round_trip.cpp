@@ -0,0 +1,72 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+
+#include <kanban_markdown/kanban_markdown.hpp>
+using namespace kanban_markdown;
+
+static bool same_trackers(const tsl::robin_map<std::string, DuplicateNameTracker>& a, const tsl::robin_map<std::string, DuplicateNameTracker>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (const auto& [name, tracker] : a) {
+		auto it = b.find(name);
+		if (it == b.end() || it->second.counter != tracker.counter || it->second.used_hash != tracker.used_hash) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	std::filesystem::path exe_dir = std::filesystem::weakly_canonical(std::filesystem::path(argv[0])).parent_path();
+	const std::string TODO_MD_PATH = exe_dir.string() + "/data/TODO.md";
+
+	if (!std::filesystem::exists(TODO_MD_PATH))
+	{
+		std::cout << "Error: Could not find TODO.md in the exe dir\n";
+		return 1;
+	}
+
+	std::ifstream todo_md_file(TODO_MD_PATH, std::ios::binary);
+	std::stringstream buffer;
+	buffer << todo_md_file.rdbuf();
+	const std::string todo_string = buffer.str();
+	todo_md_file.close();
+
+	auto maybe_kanban_board = reader::parse(todo_string);
+	if (!maybe_kanban_board.has_value()) {
+		std::cout << "Error: " << maybe_kanban_board.error() << '\n';
+		return 1;
+	}
+	const KanbanBoard& kanban_board = maybe_kanban_board.value();
+
+	const std::string binary = writer::binary::format_str(kanban_board);
+	auto maybe_binary_board = reader::binary::parse(binary);
+	if (!maybe_binary_board.has_value()) {
+		std::cout << "Error: " << maybe_binary_board.error() << '\n';
+		return 1;
+	}
+	const KanbanBoard& binary_board = maybe_binary_board.value();
+
+	// The markdown covers the properties, labels and their tasks, lists and every field of the tasks
+	if (writer::markdown::format_str(binary_board) != writer::markdown::format_str(kanban_board)) {
+		std::cout << "Error: Kanban board read from the binary format does not match\n";
+		return 1;
+	}
+	if (binary_board.checksum_version != kanban_board.checksum_version || binary_board.checksum != kanban_board.checksum) {
+		std::cout << "Error: Checksum read from the binary format does not match\n";
+		return 1;
+	}
+	if (!same_trackers(binary_board.task_name_tracker_map, kanban_board.task_name_tracker_map) || !same_trackers(binary_board.list_name_tracker_map, kanban_board.list_name_tracker_map)) {
+		std::cout << "Error: Name trackers read from the binary format do not match\n";
+		return 1;
+	}
+
+	if (reader::binary::parse(std::string_view(binary).substr(0, binary.size() - 1)).has_value()) {
+		std::cout << "Error: A truncated binary board was read\n";
+		return 1;
+	}
+	return 0;
+}
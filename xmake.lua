@@ -29,6 +29,13 @@ end
 add_requires("argparse")
 
 add_requires("re2")
+add_requires("zstd", {optional = true})
+
+option("trace")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Compile in the trace instrumentation, written as Chrome trace events when enabled at run time")
+option_end()
 
 target("kanban_markdown", function()
     set_kind("$(kind)")
@@ -42,6 +49,14 @@ target("kanban_markdown", function()
     add_includedirs("include", {public = true})
 
     add_defines("VC_EXTRALEAN", "WIN32_LEAN_AND_MEAN")
+
+    if has_config("trace") then
+        add_defines("KANBAN_MARKDOWN_TRACE", {public = true})
+    end
+
+    if is_plat("linux") then
+        add_syslinks("pthread", {public = true})
+    end
 end)
 
 if is_plat("windows", "linux", "macosx") then
@@ -49,7 +64,12 @@ if is_plat("windows", "linux", "macosx") then
         set_kind("binary")
         set_languages("cxx17")
         
-        add_packages("re2")
+        add_packages("re2", "zstd")
+        on_load(function (target)
+            if target:pkg("zstd") then
+                target:add("defines", "KANBAN_MARKDOWN_SERVER_ZSTD")
+            end
+        end)
 
         add_headerfiles("server/(**.hpp)")
         add_files("server/*.cpp")
@@ -60,6 +80,22 @@ if is_plat("windows", "linux", "macosx") then
     end)
 end
 
+if is_plat("windows", "linux", "macosx") then
+    for _, file in ipairs(os.files("benchmarks/*.cpp")) do
+        target("kanban_markdown-bench-" .. path.basename(file), function()
+            set_kind("binary")
+            set_default(false)
+            set_languages("cxx17")
+
+            add_files(file)
+
+            set_targetdir("$(buildir)/$(plat)/$(arch)/$(mode)/benchmarks")
+
+            add_deps("kanban_markdown", {public = true})
+        end)
+    end
+end
+
 if is_plat("wasm") then 
     target("kanban_markdown-wasm", function()
         set_kind("binary")